@@ -0,0 +1,100 @@
+// concurrent_lru_bench.cpp
+//
+// Hit throughput of ConcurrentLRUCache as threads are added, in both read
+// modes. Every key fits, so gets are hits; a skewed key choice makes a few
+// shards hot, as real workloads do. An optional share of puts adds writers.
+//
+//   c++ -std=c++17 -O2 -pthread concurrent_lru_bench.cpp -o concurrent_lru_bench
+//   ./concurrent_lru_bench [max_threads] [shards] [keys] [ops_per_thread] [put_percent]
+//
+// Thread counts double from 1 up to max_threads (default 32). Scaling past
+// the machine's hardware threads, printed first, only measures time slicing.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "concurrent_lru_cache.hpp"
+
+// xorshift64*; squaring a uniform draw skews keys towards the low ones
+static uint64_t next_random(uint64_t& state) {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545f4914f6cdd1dULL;
+}
+
+static uint64_t skewed_key(uint64_t& state, uint64_t keys) {
+    double u = static_cast<double>(next_random(state) >> 11) / 9007199254740992.0;
+    return static_cast<uint64_t>(u * u * static_cast<double>(keys));
+}
+
+static double run(LRUReadMode mode, unsigned threads, size_t shards, uint64_t keys, uint64_t ops,
+                  unsigned put_percent) {
+    ConcurrentLRUCache<uint64_t, uint64_t> cache(shards, keys / shards * 2 + 16, mode);
+    for (uint64_t k = 0; k < keys; k++) cache.put(k, k);
+
+    std::atomic<unsigned> ready{0};
+    std::atomic<bool> go{false};
+    std::atomic<uint64_t> misses{0};
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            uint64_t state = 0x9e3779b97f4a7c15ULL * (t + 1);
+            uint64_t missed = 0;
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            for (uint64_t i = 0; i < ops; i++) {
+                uint64_t key = skewed_key(state, keys);
+                if (put_percent > 0 && next_random(state) % 100 < put_percent) {
+                    cache.put(key, i);
+                } else if (!cache.get(key)) {
+                    missed++;
+                }
+            }
+            misses.fetch_add(missed);
+        });
+    }
+
+    while (ready.load() < threads) std::this_thread::yield();
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& w : workers) w.join();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (misses.load() > 0) std::printf("  (%llu misses)\n", static_cast<unsigned long long>(misses.load()));
+    return static_cast<double>(threads) * static_cast<double>(ops) / elapsed / 1e6;
+}
+
+int main(int argc, char** argv) {
+    unsigned max_threads = argc > 1 ? static_cast<unsigned>(std::strtoul(argv[1], nullptr, 10)) : 32;
+    size_t shards = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 16;
+    uint64_t keys = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 100000;
+    uint64_t ops = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 1000000;
+    unsigned put_percent = argc > 5 ? static_cast<unsigned>(std::strtoul(argv[5], nullptr, 10)) : 0;
+    if (max_threads == 0 || shards == 0 || keys == 0 || ops == 0 || put_percent > 100) {
+        std::fprintf(stderr, "usage: %s [max_threads] [shards] [keys] [ops_per_thread] [put_percent]\n", argv[0]);
+        return 2;
+    }
+
+    std::printf("%u hardware threads, %zu shards, %llu keys, %llu ops per thread, %u%% puts\n",
+                std::thread::hardware_concurrency(), shards, static_cast<unsigned long long>(keys),
+                static_cast<unsigned long long>(ops), put_percent);
+    std::printf("%8s %18s %18s\n", "threads", "exclusive Mops/s", "buffered Mops/s");
+
+    double base_exclusive = 0, base_buffered = 0;
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+        double exclusive = run(LRUReadMode::Exclusive, threads, shards, keys, ops, put_percent);
+        double buffered = run(LRUReadMode::Buffered, threads, shards, keys, ops, put_percent);
+        if (threads == 1) {
+            base_exclusive = exclusive;
+            base_buffered = buffered;
+        }
+        std::printf("%8u %10.2f (%4.1fx) %10.2f (%4.1fx)\n", threads, exclusive, exclusive / base_exclusive,
+                    buffered, buffered / base_buffered);
+    }
+    return 0;
+}
@@ -0,0 +1,306 @@
+// concurrent_lru_cache.hpp
+#ifndef CONCURRENT_LRU_CACHE_HPP
+#define CONCURRENT_LRU_CACHE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "lru_cache.hpp"
+
+enum class LRUReadMode {
+    Exclusive,   // get() locks its shard exclusively and updates recency at once
+    Buffered     // get() takes a shared lock; recency updates are applied in batches
+};
+
+// Lossy buffer of pointers that any number of threads add to and one thread
+// at a time drains. It is striped: each thread adds to the stripe picked by
+// a per-thread index, so threads mostly touch different cache lines. An add
+// is one CAS and never waits; it drops the item instead if the stripe is
+// full or another thread is adding to it at that moment.
+template<typename T>
+class StripedReadBuffer {
+public:
+    // stripes is rounded up to a power of two
+    explicit StripedReadBuffer(std::size_t stripes);
+
+    // Returns true once the caller's stripe is at least half full, as a hint
+    // to drain soon.
+    bool add(T* item) noexcept;
+
+    // Calls fn(item) for every item added so far. Drains must not overlap.
+    template<typename Func>
+    void drain(Func&& fn);
+
+    // Non-copyable, non-movable
+    StripedReadBuffer(const StripedReadBuffer&) = delete;
+    StripedReadBuffer& operator=(const StripedReadBuffer&) = delete;
+    StripedReadBuffer(StripedReadBuffer&&) = delete;
+    StripedReadBuffer& operator=(StripedReadBuffer&&) = delete;
+
+private:
+    static constexpr std::size_t stripe_size = 16;
+
+    struct alignas(64) Stripe {
+        std::atomic<std::size_t> write{0};   // Claimed by add
+        std::atomic<std::size_t> read{0};    // Advanced by drain
+        std::atomic<T*> slots[stripe_size] = {};
+    };
+
+    static inline std::atomic<std::size_t> next_thread_{0};
+    static inline thread_local std::size_t thread_index_ = next_thread_.fetch_add(1, std::memory_order_relaxed);
+
+    std::unique_ptr<Stripe[]> stripes_;
+    std::size_t stripe_mask_;
+};
+
+// Thread-safe LRU cache made of independently locked LRUCache shards. Keys
+// are spread over the shards by hash, so threads only contend when they hit
+// the same shard, and each shard evicts its own least recently used entry.
+//
+// In LRUReadMode::Buffered a hit only takes the shard's lock shared and
+// records the key in a StripedReadBuffer; whoever next holds the lock
+// exclusively replays the buffer into the recency list first. Recency is
+// then approximate: hits that find their stripe full or busy are dropped.
+template<typename Key, typename Value, typename Hash = std::hash<Key>>
+class ConcurrentLRUCache {
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using size_type = std::size_t;
+
+    // shard_count is rounded up to a power of two; each shard holds up to
+    // shard_capacity entries.
+    ConcurrentLRUCache(size_type shard_count, size_type shard_capacity,
+                       LRUReadMode mode = LRUReadMode::Exclusive);
+
+    std::optional<Value> get(const Key& key);
+    void put(const Key& key, const Value& value);
+    void put(const Key& key, Value&& value);
+    bool contains(const Key& key) const;
+    bool erase(const Key& key);
+    void clear();
+
+    // Sum over the shards; only a snapshot while other threads write.
+    size_type size() const;
+
+    // shard_count() * shard_capacity
+    size_type capacity() const noexcept;
+
+    size_type shard_count() const noexcept;
+
+    // Non-copyable, non-movable
+    ConcurrentLRUCache(const ConcurrentLRUCache&) = delete;
+    ConcurrentLRUCache& operator=(const ConcurrentLRUCache&) = delete;
+    ConcurrentLRUCache(ConcurrentLRUCache&&) = delete;
+    ConcurrentLRUCache& operator=(ConcurrentLRUCache&&) = delete;
+
+private:
+    static constexpr size_type max_read_stripes = 16;
+
+    // Hits waiting to be promoted point at the key inside the cache entry.
+    // They are added under the shared lock, and entries are only removed
+    // under the exclusive lock, which drains the buffer first, so the
+    // pointers are valid whenever they are replayed.
+    using ReadBuffer = StripedReadBuffer<const Key>;
+
+    struct alignas(64) Shard {
+        Shard(size_type capacity, size_type read_stripes)
+            : cache(capacity), reads(read_stripes ? std::make_unique<ReadBuffer>(read_stripes) : nullptr) {}
+
+        mutable std::shared_mutex mutex;
+        LRUCache<Key, Value, Hash> cache;
+        std::unique_ptr<ReadBuffer> reads;
+    };
+
+    Shard& shard_for(const Key& key) const;
+    std::unique_lock<std::shared_mutex> lock_exclusive(Shard& shard) const;
+    static void drain_reads(Shard& shard);
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    size_type shard_mask_;
+    size_type shard_capacity_;
+    LRUReadMode mode_;
+    Hash hash_;
+};
+
+// Implementation
+template<typename T>
+StripedReadBuffer<T>::StripedReadBuffer(std::size_t stripes) {
+    std::size_t count = 1;
+    while (count < stripes) count <<= 1;
+    stripes_ = std::make_unique<Stripe[]>(count);
+    stripe_mask_ = count - 1;
+}
+
+template<typename T>
+bool StripedReadBuffer<T>::add(T* item) noexcept {
+    Stripe& stripe = stripes_[thread_index_ & stripe_mask_];
+    std::size_t read = stripe.read.load(std::memory_order_acquire);
+    std::size_t write = stripe.write.load(std::memory_order_relaxed);
+    if (write - read >= stripe_size) return true;
+    if (!stripe.write.compare_exchange_strong(write, write + 1, std::memory_order_relaxed)) {
+        return false;
+    }
+    stripe.slots[write % stripe_size].store(item, std::memory_order_release);
+    return write + 1 - read >= stripe_size / 2;
+}
+
+// A slot claimed by an add that hasn't stored its item yet ends the stripe's
+// drain; the rest waits for the next one.
+template<typename T>
+template<typename Func>
+void StripedReadBuffer<T>::drain(Func&& fn) {
+    for (std::size_t i = 0; i <= stripe_mask_; i++) {
+        Stripe& stripe = stripes_[i];
+        std::size_t read = stripe.read.load(std::memory_order_relaxed);
+        std::size_t write = stripe.write.load(std::memory_order_acquire);
+        for (; read != write; read++) {
+            T* item = stripe.slots[read % stripe_size].exchange(nullptr, std::memory_order_acquire);
+            if (!item) break;
+            fn(item);
+        }
+        stripe.read.store(read, std::memory_order_release);
+    }
+}
+
+template<typename Key, typename Value, typename Hash>
+ConcurrentLRUCache<Key, Value, Hash>::ConcurrentLRUCache(size_type shard_count, size_type shard_capacity,
+                                                         LRUReadMode mode)
+    : shard_capacity_(shard_capacity), mode_(mode) {
+    if (shard_count == 0 || shard_capacity == 0) {
+        throw std::invalid_argument("ConcurrentLRUCache shard_count and shard_capacity must be > 0");
+    }
+
+    size_type count = 1;
+    while (count < shard_count) count <<= 1;
+    shard_mask_ = count - 1;
+
+    // About one stripe per thread that can run at once
+    size_type read_stripes = 0;
+    if (mode == LRUReadMode::Buffered) {
+        read_stripes = std::min<size_type>(std::max(1u, std::thread::hardware_concurrency()), max_read_stripes);
+    }
+
+    shards_.reserve(count);
+    for (size_type i = 0; i < count; i++) {
+        shards_.push_back(std::make_unique<Shard>(shard_capacity, read_stripes));
+    }
+}
+
+// Mixes the hash before masking: std::hash is often the identity, and the
+// shard's own unordered_map buckets on the low bits as well.
+template<typename Key, typename Value, typename Hash>
+typename ConcurrentLRUCache<Key, Value, Hash>::Shard&
+ConcurrentLRUCache<Key, Value, Hash>::shard_for(const Key& key) const {
+    uint64_t h = static_cast<uint64_t>(hash_(key));
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return *shards_[h & shard_mask_];
+}
+
+template<typename Key, typename Value, typename Hash>
+std::unique_lock<std::shared_mutex> ConcurrentLRUCache<Key, Value, Hash>::lock_exclusive(Shard& shard) const {
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    if (shard.reads) drain_reads(shard);
+    return lock;
+}
+
+template<typename Key, typename Value, typename Hash>
+void ConcurrentLRUCache<Key, Value, Hash>::drain_reads(Shard& shard) {
+    shard.reads->drain([&](const Key* key) { shard.cache.promote(*key); });
+}
+
+template<typename Key, typename Value, typename Hash>
+std::optional<Value> ConcurrentLRUCache<Key, Value, Hash>::get(const Key& key) {
+    Shard& shard = shard_for(key);
+    if (mode_ == LRUReadMode::Exclusive) {
+        std::lock_guard<std::shared_mutex> lock(shard.mutex);
+        return shard.cache.get(key);
+    }
+
+    std::optional<Value> value;
+    bool drain;
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto entry = shard.cache.find(key);
+        if (!entry) return std::nullopt;
+        value = entry->second;
+        drain = shard.reads->add(&entry->first);
+    }
+
+    // Replay the buffer once it fills up, unless someone else already is
+    if (drain) {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex, std::try_to_lock);
+        if (lock.owns_lock()) drain_reads(shard);
+    }
+    return value;
+}
+
+template<typename Key, typename Value, typename Hash>
+void ConcurrentLRUCache<Key, Value, Hash>::put(const Key& key, const Value& value) {
+    Shard& shard = shard_for(key);
+    auto lock = lock_exclusive(shard);
+    shard.cache.put(key, value);
+}
+
+template<typename Key, typename Value, typename Hash>
+void ConcurrentLRUCache<Key, Value, Hash>::put(const Key& key, Value&& value) {
+    Shard& shard = shard_for(key);
+    auto lock = lock_exclusive(shard);
+    shard.cache.put(key, std::move(value));
+}
+
+template<typename Key, typename Value, typename Hash>
+bool ConcurrentLRUCache<Key, Value, Hash>::contains(const Key& key) const {
+    Shard& shard = shard_for(key);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    return shard.cache.contains(key);
+}
+
+template<typename Key, typename Value, typename Hash>
+bool ConcurrentLRUCache<Key, Value, Hash>::erase(const Key& key) {
+    Shard& shard = shard_for(key);
+    auto lock = lock_exclusive(shard);
+    return shard.cache.erase(key);
+}
+
+template<typename Key, typename Value, typename Hash>
+void ConcurrentLRUCache<Key, Value, Hash>::clear() {
+    for (auto& shard : shards_) {
+        auto lock = lock_exclusive(*shard);
+        shard->cache.clear();
+    }
+}
+
+template<typename Key, typename Value, typename Hash>
+typename ConcurrentLRUCache<Key, Value, Hash>::size_type ConcurrentLRUCache<Key, Value, Hash>::size() const {
+    size_type total = 0;
+    for (const auto& shard : shards_) {
+        std::shared_lock<std::shared_mutex> lock(shard->mutex);
+        total += shard->cache.size();
+    }
+    return total;
+}
+
+template<typename Key, typename Value, typename Hash>
+typename ConcurrentLRUCache<Key, Value, Hash>::size_type ConcurrentLRUCache<Key, Value, Hash>::capacity() const noexcept {
+    return shards_.size() * shard_capacity_;
+}
+
+template<typename Key, typename Value, typename Hash>
+typename ConcurrentLRUCache<Key, Value, Hash>::size_type
+ConcurrentLRUCache<Key, Value, Hash>::shard_count() const noexcept {
+    return shards_.size();
+}
+
+#endif // CONCURRENT_LRU_CACHE_HPP
@@ -2,18 +2,145 @@
 #ifndef EVENT_QUEUE_HPP
 #define EVENT_QUEUE_HPP
 
-#include <queue>
+#include <array>
+#include <deque>
+#include <memory>
 #include <mutex>
 #include <condition_variable>
 #include <optional>
 #include <chrono>
+#include <iterator>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
 
-template<typename T>
+// async_pop/async_push need C++20 coroutines
+#if defined(__has_include)
+#if __has_include(<coroutine>) && defined(__cpp_impl_coroutine)
+#define EVENT_QUEUE_COROUTINES 1
+#endif
+#endif
+
+#ifdef EVENT_QUEUE_COROUTINES
+#include <coroutine>
+#include <functional>
+#include <thread>
+#include "timer_event_queue.hpp"
+#endif
+
+// Backend policies for EventQueue
+struct MutexBackend {};      // Circular buffer behind a mutex; optionally bounded
+struct LockFreeBounded {};   // Preallocated lock-free ring; max_size required
+
+// Metrics policies for EventQueue. The default records nothing and costs nothing.
+struct NoQueueMetrics {
+    static constexpr bool enabled = false;
+};
+
+// Counts pushes, pops, depth, blocking and lock contention in relaxed
+// atomics, so snapshot() never takes the queue lock. Enqueue-to-dequeue
+// latency comes from a FIFO of push timestamps that shadows the queue and,
+// like it, is only touched under the queue mutex.
+class QueueMetrics {
+public:
+    static constexpr bool enabled = true;
+    static constexpr size_t latency_buckets = 64;
+
+    struct Snapshot {
+        uint64_t pushes;
+        uint64_t pops;
+        size_t depth;
+        size_t max_depth;
+        uint64_t lock_acquisitions;
+        uint64_t lock_contended;               // Acquisitions that had to wait
+        uint64_t producer_waits;               // Pushes that blocked on a full queue
+        uint64_t consumer_waits;               // Pops that blocked on an empty queue
+        std::chrono::nanoseconds producer_blocked;
+        std::chrono::nanoseconds consumer_blocked;
+        std::array<uint64_t, latency_buckets> latency;   // [i]: items queued for [2^i, 2^(i+1)) ns
+
+        // Upper bound of the latency bucket holding quantile q (0..1)
+        std::chrono::nanoseconds latency_quantile(double q) const noexcept;
+    };
+
+    Snapshot snapshot() const noexcept;
+
+    // Hooks called by EventQueue. prepare_push stamps the item about to be
+    // queued and is the only one that can throw; cancel_push drops the stamp
+    // again if queueing fails.
+    void record_lock(bool contended) noexcept;
+    void prepare_push();
+    void cancel_push() noexcept;
+    void record_push(size_t depth) noexcept;
+    void record_pop(size_t depth) noexcept;
+    void record_clear() noexcept;
+    void record_wait(bool producer, std::chrono::steady_clock::duration blocked) noexcept;
+
+private:
+    std::deque<std::chrono::steady_clock::time_point> stamps_;
+    std::atomic<uint64_t> pushes_{0};
+    std::atomic<uint64_t> pops_{0};
+    std::atomic<size_t> depth_{0};
+    std::atomic<size_t> max_depth_{0};
+    std::atomic<uint64_t> lock_acquisitions_{0};
+    std::atomic<uint64_t> lock_contended_{0};
+    std::atomic<uint64_t> producer_waits_{0};
+    std::atomic<uint64_t> consumer_waits_{0};
+    std::atomic<int64_t> producer_blocked_ns_{0};
+    std::atomic<int64_t> consumer_blocked_ns_{0};
+    std::array<std::atomic<uint64_t>, latency_buckets> latency_{};
+};
+
+// FIFO storage for the mutex backend: a circular buffer allocated from
+// Allocator. A bounded queue allocates it once, at full size; an unbounded
+// one doubles it when full. Either way pushing and popping in steady state
+// never touches the allocator.
+template<typename T, typename Allocator>
+class EventQueueStorage {
+public:
+    EventQueueStorage(const Allocator& alloc, size_t capacity);
+    ~EventQueueStorage();
+
+    template<typename... Args>
+    void emplace(Args&&... args);
+
+    T& front() noexcept;
+    void pop() noexcept;
+    void clear() noexcept;
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+
+    EventQueueStorage(const EventQueueStorage&) = delete;
+    EventQueueStorage& operator=(const EventQueueStorage&) = delete;
+
+private:
+    using Traits = std::allocator_traits<Allocator>;
+
+    void grow();
+
+    Allocator alloc_;
+    T* items_ = nullptr;
+    size_t capacity_ = 0;
+    size_t head_ = 0;     // Index of the front item
+    size_t count_ = 0;
+};
+
+template<typename T, typename Allocator = std::allocator<T>, typename Backend = MutexBackend,
+         typename Metrics = NoQueueMetrics>
 class EventQueue {
 public:
+    using allocator_type = Allocator;
+
     // TODO: Document this constructor
     explicit EventQueue(size_t max_size = 0);
 
+    // The queue's storage is obtained from alloc, e.g. a PoolAllocator,
+    // instead of the global heap.
+    EventQueue(size_t max_size, const Allocator& alloc);
+
     // TODO: Document this destructor
     ~EventQueue();
 
@@ -27,9 +154,30 @@ public:
     template<typename... Args>
     bool emplace(Args&&... args);
 
+    // Pushes copies of [first, last) under as few lock acquisitions as
+    // possible, waiting for space when bounded. Returns the number pushed,
+    // which is short only if the queue was closed.
+    template<typename InputIt>
+    size_t push_range(InputIt first, InputIt last);
+
+    // Moves every element of items into the queue like push_range. Pushed
+    // elements are erased, so items is left holding any that weren't.
+    size_t push_bulk(std::vector<T>&& items);
+
     // TODO: Document this function
     std::optional<T> pop();
 
+    // Waits until the queue is non-empty or closed, then moves up to
+    // max_items to out in one lock acquisition. Returns the number moved;
+    // 0 means the queue is closed and empty. max_items == 0 returns 0
+    // at once without waiting.
+    template<typename OutputIt>
+    size_t pop_batch(OutputIt out, size_t max_items);
+
+    // Like pop_batch, but gives up after timeout and returns 0.
+    template<typename OutputIt, typename Rep, typename Period>
+    size_t drain_for(OutputIt out, size_t max_items, const std::chrono::duration<Rep, Period>& timeout);
+
     // TODO: Document this function
     std::optional<T> try_pop();
 
@@ -56,6 +204,31 @@ public:
     // TODO: Document this function
     void clear();
 
+    // The metrics policy, e.g. queue.metrics().snapshot() with QueueMetrics
+    const Metrics& metrics() const noexcept;
+
+#ifdef EVENT_QUEUE_COROUTINES
+    class AsyncPop;
+    class AsyncPush;
+
+    // co_await queue.async_pop(executor) yields what pop() would, but
+    // suspends the coroutine instead of blocking the thread. It is resumed
+    // through executor.post(fn) once an item is handed to it or the queue is
+    // closed; post must queue fn, not run it inline. Doesn't suspend at all
+    // if an item is already available.
+    template<typename Executor>
+    AsyncPop async_pop(Executor& executor);
+
+    // Like async_pop, but resumes with std::nullopt after timeout, as pop_for.
+    template<typename Rep, typename Period, typename Executor>
+    AsyncPop async_pop_for(const std::chrono::duration<Rep, Period>& timeout, Executor& executor);
+
+    // co_await queue.async_push(item, executor) yields what push() would,
+    // suspending while a bounded queue is full.
+    template<typename Executor>
+    AsyncPush async_push(T item, Executor& executor);
+#endif
+
     // Non-copyable, non-movable
     EventQueue(const EventQueue&) = delete;
     EventQueue& operator=(const EventQueue&) = delete;
@@ -63,168 +236,1295 @@ public:
     EventQueue& operator=(EventQueue&&) = delete;
 
 private:
+    template<typename OutputIt>
+    size_t drain_locked(OutputIt out, size_t max_items);
+
+    // Hands items and free space to suspended coroutines; called with the
+    // mutex held after anything that adds items, frees space or closes.
+    void serve_async_locked();
+
+    // Lock and storage accessors that feed Metrics. With NoQueueMetrics they
+    // reduce to the plain mutex and storage calls.
+    std::unique_lock<std::mutex> lock_queue() const;
+
+    template<typename... Args>
+    void push_locked(Args&&... args);
+
+    void pop_locked() noexcept;
+    void clear_locked() noexcept;
+    std::chrono::steady_clock::time_point wait_start() const noexcept;
+    void wait_end(const size_t& waiters, std::chrono::steady_clock::time_point start) noexcept;
+
+#ifdef EVENT_QUEUE_COROUTINES
+    struct AsyncTimeout;
+
+    // A suspended coroutine, linked into async_pops_ or async_pushes_ while
+    // it waits. Whoever sets *claimed first (a push, a pop, close() or the
+    // timeout) completes the wait and is the only one to touch it after.
+    struct AsyncWaiter {
+        AsyncWaiter* prev = nullptr;
+        AsyncWaiter* next = nullptr;
+        std::coroutine_handle<> handle;
+        void* executor = nullptr;
+        void (*post)(void* executor, std::coroutine_handle<> handle) = nullptr;
+        std::atomic<bool> own_claim{false};
+        std::atomic<bool>* claimed = &own_claim;
+        std::optional<T> item;       // Popped item, or the item to push
+        bool pushed = false;
+        uint64_t timer = 0;
+        std::shared_ptr<AsyncTimeout> timeout;
+    };
+
+    // Shared with the timeout callback, which may outlive the waiter
+    struct AsyncTimeout {
+        std::atomic<bool> claimed{false};
+        EventQueue* queue;
+        AsyncWaiter* waiter;
+    };
+
+    struct AsyncList {
+        AsyncWaiter* head = nullptr;
+        AsyncWaiter* tail = nullptr;
+    };
+
+    template<typename Executor>
+    static void post_resume(void* executor, std::coroutine_handle<> handle);
+
+    static void async_link(AsyncList& list, AsyncWaiter* waiter) noexcept;
+    static void async_unlink(AsyncList& list, AsyncWaiter* waiter) noexcept;
+    static AsyncWaiter* async_claim(AsyncList& list) noexcept;
+    static void async_complete(AsyncWaiter* waiter);
+    static TimerEventQueue<std::function<void()>>& async_timers();
+
+    bool async_suspend_pop(AsyncWaiter& waiter, const std::chrono::steady_clock::duration* timeout);
+    bool async_suspend_push(AsyncWaiter& waiter);
+    void async_expire(AsyncWaiter* waiter);
+
+    AsyncList async_pops_;
+    AsyncList async_pushes_;
+#endif
+
+    // Condition-variable waits that keep count of the threads blocked in
+    // them, so notifications can be skipped when nobody is waiting
+    template<typename Predicate>
+    void wait(std::condition_variable& cv, std::unique_lock<std::mutex>& lock,
+              size_t& waiters, Predicate ready);
+
+    template<typename Clock, typename Duration, typename Predicate>
+    bool wait_until(std::condition_variable& cv, std::unique_lock<std::mutex>& lock, size_t& waiters,
+                    const std::chrono::time_point<Clock, Duration>& deadline, Predicate ready);
+
+    void notify(std::condition_variable& cv, size_t waiters, size_t items);
+
     mutable std::mutex mutex_;
+    [[no_unique_address]] mutable Metrics metrics_;
     std::condition_variable not_empty_;
     std::condition_variable not_full_;
-    std::queue<T> queue_;
+    EventQueueStorage<T, Allocator> queue_;
     size_t max_size_;
+    size_t waiting_consumers_ = 0;
+    size_t waiting_producers_ = 0;
     bool closed_ = false;
 };
 
 // Implementation
-template<typename T>
-EventQueue<T>::EventQueue(size_t max_size) : max_size_(max_size) {}
+inline std::chrono::nanoseconds QueueMetrics::Snapshot::latency_quantile(double q) const noexcept {
+    uint64_t total = 0;
+    for (uint64_t count : latency) total += count;
+    if (total == 0) return std::chrono::nanoseconds(0);
 
-template<typename T>
-EventQueue<T>::~EventQueue() {
+    uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(total - 1));
+    uint64_t seen = 0;
+    for (size_t i = 0; i + 1 < latency_buckets; i++) {
+        seen += latency[i];
+        if (seen > rank) return std::chrono::nanoseconds(int64_t(1) << (i + 1));
+    }
+    return std::chrono::nanoseconds::max();
+}
+
+inline QueueMetrics::Snapshot QueueMetrics::snapshot() const noexcept {
+    Snapshot snap;
+    snap.pushes = pushes_.load(std::memory_order_relaxed);
+    snap.pops = pops_.load(std::memory_order_relaxed);
+    snap.depth = depth_.load(std::memory_order_relaxed);
+    snap.max_depth = max_depth_.load(std::memory_order_relaxed);
+    snap.lock_acquisitions = lock_acquisitions_.load(std::memory_order_relaxed);
+    snap.lock_contended = lock_contended_.load(std::memory_order_relaxed);
+    snap.producer_waits = producer_waits_.load(std::memory_order_relaxed);
+    snap.consumer_waits = consumer_waits_.load(std::memory_order_relaxed);
+    snap.producer_blocked = std::chrono::nanoseconds(producer_blocked_ns_.load(std::memory_order_relaxed));
+    snap.consumer_blocked = std::chrono::nanoseconds(consumer_blocked_ns_.load(std::memory_order_relaxed));
+    for (size_t i = 0; i < latency_buckets; i++) {
+        snap.latency[i] = latency_[i].load(std::memory_order_relaxed);
+    }
+    return snap;
+}
+
+inline void QueueMetrics::record_lock(bool contended) noexcept {
+    lock_acquisitions_.fetch_add(1, std::memory_order_relaxed);
+    if (contended) lock_contended_.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void QueueMetrics::prepare_push() {
+    stamps_.push_back(std::chrono::steady_clock::now());
+}
+
+inline void QueueMetrics::cancel_push() noexcept {
+    stamps_.pop_back();
+}
+
+inline void QueueMetrics::record_push(size_t depth) noexcept {
+    pushes_.fetch_add(1, std::memory_order_relaxed);
+    depth_.store(depth, std::memory_order_relaxed);
+    // Only ever raised under the queue mutex, so a plain compare suffices
+    if (depth > max_depth_.load(std::memory_order_relaxed)) {
+        max_depth_.store(depth, std::memory_order_relaxed);
+    }
+}
+
+inline void QueueMetrics::record_pop(size_t depth) noexcept {
+    pops_.fetch_add(1, std::memory_order_relaxed);
+    depth_.store(depth, std::memory_order_relaxed);
+    if (stamps_.empty()) return;
+
+    auto queued = std::chrono::steady_clock::now() - stamps_.front();
+    stamps_.pop_front();
+    uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(queued).count());
+    latency_[63 - __builtin_clzll(ns | 1)].fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void QueueMetrics::record_clear() noexcept {
+    stamps_.clear();
+    depth_.store(0, std::memory_order_relaxed);
+}
+
+inline void QueueMetrics::record_wait(bool producer, std::chrono::steady_clock::duration blocked) noexcept {
+    int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(blocked).count();
+    if (producer) {
+        producer_waits_.fetch_add(1, std::memory_order_relaxed);
+        producer_blocked_ns_.fetch_add(ns, std::memory_order_relaxed);
+    } else {
+        consumer_waits_.fetch_add(1, std::memory_order_relaxed);
+        consumer_blocked_ns_.fetch_add(ns, std::memory_order_relaxed);
+    }
+}
+
+template<typename T, typename Allocator>
+EventQueueStorage<T, Allocator>::EventQueueStorage(const Allocator& alloc, size_t capacity)
+    : alloc_(alloc) {
+    if (capacity > 0) {
+        items_ = Traits::allocate(alloc_, capacity);
+        capacity_ = capacity;
+    }
+}
+
+template<typename T, typename Allocator>
+EventQueueStorage<T, Allocator>::~EventQueueStorage() {
+    clear();
+    if (items_) Traits::deallocate(alloc_, items_, capacity_);
+}
+
+template<typename T, typename Allocator>
+template<typename... Args>
+void EventQueueStorage<T, Allocator>::emplace(Args&&... args) {
+    if (count_ == capacity_) grow();
+    size_t index = head_ + count_;
+    if (index >= capacity_) index -= capacity_;
+    Traits::construct(alloc_, items_ + index, std::forward<Args>(args)...);
+    count_++;
+}
+
+template<typename T, typename Allocator>
+T& EventQueueStorage<T, Allocator>::front() noexcept {
+    return items_[head_];
+}
+
+template<typename T, typename Allocator>
+void EventQueueStorage<T, Allocator>::pop() noexcept {
+    Traits::destroy(alloc_, items_ + head_);
+    if (++head_ == capacity_) head_ = 0;
+    count_--;
+}
+
+template<typename T, typename Allocator>
+void EventQueueStorage<T, Allocator>::clear() noexcept {
+    while (count_ > 0) pop();
+    head_ = 0;
+}
+
+template<typename T, typename Allocator>
+size_t EventQueueStorage<T, Allocator>::size() const noexcept {
+    return count_;
+}
+
+template<typename T, typename Allocator>
+bool EventQueueStorage<T, Allocator>::empty() const noexcept {
+    return count_ == 0;
+}
+
+template<typename T, typename Allocator>
+void EventQueueStorage<T, Allocator>::grow() {
+    size_t capacity = capacity_ ? capacity_ * 2 : 16;
+    T* items = Traits::allocate(alloc_, capacity);
+
+    size_t moved = 0;
+    try {
+        for (; moved < count_; moved++) {
+            size_t index = head_ + moved;
+            if (index >= capacity_) index -= capacity_;
+            Traits::construct(alloc_, items + moved, std::move_if_noexcept(items_[index]));
+        }
+    } catch (...) {
+        for (size_t i = 0; i < moved; i++) Traits::destroy(alloc_, items + i);
+        Traits::deallocate(alloc_, items, capacity);
+        throw;
+    }
+
+    size_t count = count_;
+    clear();
+    if (items_) Traits::deallocate(alloc_, items_, capacity_);
+    items_ = items;
+    capacity_ = capacity;
+    head_ = 0;
+    count_ = count;
+}
+
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+EventQueue<T, Allocator, Backend, Metrics>::EventQueue(size_t max_size)
+    : queue_(Allocator(), max_size), max_size_(max_size) {}
+
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+EventQueue<T, Allocator, Backend, Metrics>::EventQueue(size_t max_size, const Allocator& alloc)
+    : queue_(alloc, max_size), max_size_(max_size) {}
+
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+EventQueue<T, Allocator, Backend, Metrics>::~EventQueue() {
     close();
+#ifdef EVENT_QUEUE_COROUTINES
+    // Timeouts that fired during close() still have to unlink their waiters
+    auto lock = lock_queue();
+    not_empty_.wait(lock, [this] { return async_pops_.head == nullptr; });
+#endif
 }
 
-template<typename T>
-bool EventQueue<T>::push(const T& item) {
-    std::unique_lock<std::mutex> lock(mutex_);
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+bool EventQueue<T, Allocator, Backend, Metrics>::push(const T& item) {
+    auto lock = lock_queue();
 
     if (max_size_ > 0) {
-        not_full_.wait(lock, [this] {
+        wait(not_full_, lock, waiting_producers_, [this] {
             return closed_ || queue_.size() < max_size_;
         });
     }
 
     if (closed_) return false;
 
-    queue_.push(item);
-    not_empty_.notify_one();
+    push_locked(item);
+    notify(not_empty_, waiting_consumers_, 1);
+    serve_async_locked();
     return true;
 }
 
-template<typename T>
-bool EventQueue<T>::push(T&& item) {
-    std::unique_lock<std::mutex> lock(mutex_);
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+bool EventQueue<T, Allocator, Backend, Metrics>::push(T&& item) {
+    auto lock = lock_queue();
 
     if (max_size_ > 0) {
-        not_full_.wait(lock, [this] {
+        wait(not_full_, lock, waiting_producers_, [this] {
             return closed_ || queue_.size() < max_size_;
         });
     }
 
     if (closed_) return false;
 
-    queue_.push(std::move(item));
-    not_empty_.notify_one();
+    push_locked(std::move(item));
+    notify(not_empty_, waiting_consumers_, 1);
+    serve_async_locked();
     return true;
 }
 
-template<typename T>
+template<typename T, typename Allocator, typename Backend, typename Metrics>
 template<typename... Args>
-bool EventQueue<T>::emplace(Args&&... args) {
-    std::unique_lock<std::mutex> lock(mutex_);
+bool EventQueue<T, Allocator, Backend, Metrics>::emplace(Args&&... args) {
+    auto lock = lock_queue();
 
     if (max_size_ > 0) {
-        not_full_.wait(lock, [this] {
+        wait(not_full_, lock, waiting_producers_, [this] {
             return closed_ || queue_.size() < max_size_;
         });
     }
 
     if (closed_) return false;
 
-    queue_.emplace(std::forward<Args>(args)...);
-    not_empty_.notify_one();
+    push_locked(std::forward<Args>(args)...);
+    notify(not_empty_, waiting_consumers_, 1);
+    serve_async_locked();
     return true;
 }
 
-template<typename T>
-std::optional<T> EventQueue<T>::pop() {
-    std::unique_lock<std::mutex> lock(mutex_);
-    not_empty_.wait(lock, [this] { return closed_ || !queue_.empty(); });
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+template<typename InputIt>
+size_t EventQueue<T, Allocator, Backend, Metrics>::push_range(InputIt first, InputIt last) {
+    size_t pushed = 0;
+    auto lock = lock_queue();
+
+    while (first != last) {
+        if (max_size_ > 0) {
+            wait(not_full_, lock, waiting_producers_, [this] {
+                return closed_ || queue_.size() < max_size_;
+            });
+        }
+
+        if (closed_) break;
+
+        size_t batch = 0;
+        do {
+            push_locked(*first);
+            ++first;
+            ++batch;
+        } while (first != last && (max_size_ == 0 || queue_.size() < max_size_));
+
+        pushed += batch;
+        notify(not_empty_, waiting_consumers_, batch);
+        serve_async_locked();
+    }
+    return pushed;
+}
+
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+size_t EventQueue<T, Allocator, Backend, Metrics>::push_bulk(std::vector<T>&& items) {
+    size_t pushed = push_range(std::make_move_iterator(items.begin()),
+                               std::make_move_iterator(items.end()));
+    items.erase(items.begin(), items.begin() + pushed);
+    return pushed;
+}
+
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+std::optional<T> EventQueue<T, Allocator, Backend, Metrics>::pop() {
+    auto lock = lock_queue();
+    wait(not_empty_, lock, waiting_consumers_, [this] { return closed_ || !queue_.empty(); });
 
     if (queue_.empty()) return std::nullopt;
 
     T item = std::move(queue_.front());
-    queue_.pop();
-    not_full_.notify_one();
+    pop_locked();
+    notify(not_full_, waiting_producers_, 1);
+    serve_async_locked();
     return item;
 }
 
-template<typename T>
-std::optional<T> EventQueue<T>::try_pop() {
-    std::lock_guard<std::mutex> lock(mutex_);
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+std::optional<T> EventQueue<T, Allocator, Backend, Metrics>::try_pop() {
+    auto lock = lock_queue();
 
     if (queue_.empty()) return std::nullopt;
 
     T item = std::move(queue_.front());
-    queue_.pop();
-    not_full_.notify_one();
+    pop_locked();
+    notify(not_full_, waiting_producers_, 1);
+    serve_async_locked();
     return item;
 }
 
-template<typename T>
+template<typename T, typename Allocator, typename Backend, typename Metrics>
 template<typename Rep, typename Period>
-std::optional<T> EventQueue<T>::pop_for(const std::chrono::duration<Rep, Period>& timeout) {
-    std::unique_lock<std::mutex> lock(mutex_);
+std::optional<T> EventQueue<T, Allocator, Backend, Metrics>::pop_for(const std::chrono::duration<Rep, Period>& timeout) {
+    auto lock = lock_queue();
 
-    if (!not_empty_.wait_for(lock, timeout, [this] { return closed_ || !queue_.empty(); })) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    if (!wait_until(not_empty_, lock, waiting_consumers_, deadline,
+                    [this] { return closed_ || !queue_.empty(); })) {
         return std::nullopt;
     }
 
     if (queue_.empty()) return std::nullopt;
 
     T item = std::move(queue_.front());
-    queue_.pop();
-    not_full_.notify_one();
+    pop_locked();
+    notify(not_full_, waiting_producers_, 1);
+    serve_async_locked();
     return item;
 }
 
-template<typename T>
+template<typename T, typename Allocator, typename Backend, typename Metrics>
 template<typename Clock, typename Duration>
-std::optional<T> EventQueue<T>::pop_until(const std::chrono::time_point<Clock, Duration>& deadline) {
-    std::unique_lock<std::mutex> lock(mutex_);
+std::optional<T> EventQueue<T, Allocator, Backend, Metrics>::pop_until(const std::chrono::time_point<Clock, Duration>& deadline) {
+    auto lock = lock_queue();
 
-    if (!not_empty_.wait_until(lock, deadline, [this] { return closed_ || !queue_.empty(); })) {
+    if (!wait_until(not_empty_, lock, waiting_consumers_, deadline,
+                    [this] { return closed_ || !queue_.empty(); })) {
         return std::nullopt;
     }
 
     if (queue_.empty()) return std::nullopt;
 
     T item = std::move(queue_.front());
-    queue_.pop();
-    not_full_.notify_one();
+    pop_locked();
+    notify(not_full_, waiting_producers_, 1);
+    serve_async_locked();
     return item;
 }
 
-template<typename T>
-void EventQueue<T>::close() {
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+template<typename OutputIt>
+size_t EventQueue<T, Allocator, Backend, Metrics>::pop_batch(OutputIt out, size_t max_items) {
+    if (max_items == 0) return 0;
+    auto lock = lock_queue();
+    wait(not_empty_, lock, waiting_consumers_, [this] { return closed_ || !queue_.empty(); });
+    return drain_locked(out, max_items);
+}
+
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+template<typename OutputIt, typename Rep, typename Period>
+size_t EventQueue<T, Allocator, Backend, Metrics>::drain_for(OutputIt out, size_t max_items,
+                                                             const std::chrono::duration<Rep, Period>& timeout) {
+    if (max_items == 0) return 0;
+    auto lock = lock_queue();
+
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    if (!wait_until(not_empty_, lock, waiting_consumers_, deadline,
+                    [this] { return closed_ || !queue_.empty(); })) {
+        return 0;
+    }
+
+    return drain_locked(out, max_items);
+}
+
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+template<typename OutputIt>
+size_t EventQueue<T, Allocator, Backend, Metrics>::drain_locked(OutputIt out, size_t max_items) {
+    size_t taken = 0;
+    while (taken < max_items && !queue_.empty()) {
+        *out = std::move(queue_.front());
+        ++out;
+        pop_locked();
+        ++taken;
+    }
+
+    notify(not_full_, waiting_producers_, taken);
+    serve_async_locked();
+    return taken;
+}
+
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+template<typename Predicate>
+void EventQueue<T, Allocator, Backend, Metrics>::wait(std::condition_variable& cv, std::unique_lock<std::mutex>& lock,
+                                                      size_t& waiters, Predicate ready) {
+    if (ready()) return;
+
+    auto start = wait_start();
+    do {
+        waiters++;
+        cv.wait(lock);
+        waiters--;
+    } while (!ready());
+    wait_end(waiters, start);
+}
+
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+template<typename Clock, typename Duration, typename Predicate>
+bool EventQueue<T, Allocator, Backend, Metrics>::wait_until(std::condition_variable& cv,
+                                                            std::unique_lock<std::mutex>& lock, size_t& waiters,
+                                                            const std::chrono::time_point<Clock, Duration>& deadline,
+                                                            Predicate ready) {
+    if (ready()) return true;
+
+    auto start = wait_start();
+    bool woken = true;
+    do {
+        waiters++;
+        std::cv_status status = cv.wait_until(lock, deadline);
+        waiters--;
+        if (status == std::cv_status::timeout) {
+            woken = ready();
+            break;
+        }
+    } while (!ready());
+    wait_end(waiters, start);
+    return woken;
+}
+
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+void EventQueue<T, Allocator, Backend, Metrics>::notify(std::condition_variable& cv, size_t waiters, size_t items) {
+    if (waiters == 0 || items == 0) return;
+    if (items == 1) {
+        cv.notify_one();
+    } else {
+        cv.notify_all();
+    }
+}
+
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+void EventQueue<T, Allocator, Backend, Metrics>::close() {
     {
-        std::lock_guard<std::mutex> lock(mutex_);
+        auto lock = lock_queue();
         closed_ = true;
+        serve_async_locked();
     }
     not_empty_.notify_all();
     not_full_.notify_all();
 }
 
-template<typename T>
-bool EventQueue<T>::is_closed() const {
-    std::lock_guard<std::mutex> lock(mutex_);
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+bool EventQueue<T, Allocator, Backend, Metrics>::is_closed() const {
+    auto lock = lock_queue();
     return closed_;
 }
 
-template<typename T>
-size_t EventQueue<T>::size() const {
-    std::lock_guard<std::mutex> lock(mutex_);
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+size_t EventQueue<T, Allocator, Backend, Metrics>::size() const {
+    auto lock = lock_queue();
     return queue_.size();
 }
 
-template<typename T>
-bool EventQueue<T>::empty() const {
-    std::lock_guard<std::mutex> lock(mutex_);
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+bool EventQueue<T, Allocator, Backend, Metrics>::empty() const {
+    auto lock = lock_queue();
     return queue_.empty();
 }
 
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+void EventQueue<T, Allocator, Backend, Metrics>::clear() {
+    auto lock = lock_queue();
+    size_t cleared = queue_.size();
+    clear_locked();
+    notify(not_full_, waiting_producers_, cleared);
+    serve_async_locked();
+}
+
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+const Metrics& EventQueue<T, Allocator, Backend, Metrics>::metrics() const noexcept {
+    return metrics_;
+}
+
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+std::unique_lock<std::mutex> EventQueue<T, Allocator, Backend, Metrics>::lock_queue() const {
+    if constexpr (Metrics::enabled) {
+        std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+        metrics_.record_lock(!lock.owns_lock());
+        if (!lock.owns_lock()) lock.lock();
+        return lock;
+    } else {
+        return std::unique_lock<std::mutex>(mutex_);
+    }
+}
+
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+template<typename... Args>
+void EventQueue<T, Allocator, Backend, Metrics>::push_locked(Args&&... args) {
+    if constexpr (Metrics::enabled) {
+        // Stamp first, so a failure to record can't follow a successful push
+        metrics_.prepare_push();
+        try {
+            queue_.emplace(std::forward<Args>(args)...);
+        } catch (...) {
+            metrics_.cancel_push();
+            throw;
+        }
+        metrics_.record_push(queue_.size());
+    } else {
+        queue_.emplace(std::forward<Args>(args)...);
+    }
+}
+
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+void EventQueue<T, Allocator, Backend, Metrics>::pop_locked() noexcept {
+    queue_.pop();
+    if constexpr (Metrics::enabled) metrics_.record_pop(queue_.size());
+}
+
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+void EventQueue<T, Allocator, Backend, Metrics>::clear_locked() noexcept {
+    queue_.clear();
+    if constexpr (Metrics::enabled) metrics_.record_clear();
+}
+
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+std::chrono::steady_clock::time_point EventQueue<T, Allocator, Backend, Metrics>::wait_start() const noexcept {
+    if constexpr (Metrics::enabled) return std::chrono::steady_clock::now();
+    return {};
+}
+
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+void EventQueue<T, Allocator, Backend, Metrics>::wait_end(const size_t& waiters,
+                                                          std::chrono::steady_clock::time_point start) noexcept {
+    if constexpr (Metrics::enabled) {
+        metrics_.record_wait(&waiters == &waiting_producers_, std::chrono::steady_clock::now() - start);
+    }
+}
+
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+void EventQueue<T, Allocator, Backend, Metrics>::serve_async_locked() {
+#ifdef EVENT_QUEUE_COROUTINES
+    if (!async_pops_.head && !async_pushes_.head) return;
+
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        while (!queue_.empty() && async_pops_.head) {
+            AsyncWaiter* waiter = async_claim(async_pops_);
+            if (!waiter) break;
+            waiter->item.emplace(std::move(queue_.front()));
+            pop_locked();
+            notify(not_full_, waiting_producers_, 1);
+            async_complete(waiter);
+            progress = true;
+        }
+        while (!closed_ && async_pushes_.head && (max_size_ == 0 || queue_.size() < max_size_)) {
+            AsyncWaiter* waiter = async_claim(async_pushes_);
+            if (!waiter) break;
+            push_locked(std::move(*waiter->item));
+            waiter->pushed = true;
+            notify(not_empty_, waiting_consumers_, 1);
+            async_complete(waiter);
+            progress = true;
+        }
+    }
+
+    if (!closed_) return;
+    while (AsyncWaiter* waiter = async_claim(async_pops_)) async_complete(waiter);
+    while (AsyncWaiter* waiter = async_claim(async_pushes_)) async_complete(waiter);
+#endif
+}
+
+#ifdef EVENT_QUEUE_COROUTINES
+// Awaitable returned by async_pop and async_pop_for
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+class EventQueue<T, Allocator, Backend, Metrics>::AsyncPop {
+public:
+    template<typename Executor>
+    AsyncPop(EventQueue& queue, Executor& executor, std::optional<std::chrono::steady_clock::duration> timeout)
+        : queue_(queue), timeout_(timeout) {
+        waiter_.executor = &executor;
+        waiter_.post = &EventQueue::post_resume<Executor>;
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+        waiter_.handle = handle;
+        return queue_.async_suspend_pop(waiter_, timeout_ ? &*timeout_ : nullptr);
+    }
+
+    std::optional<T> await_resume() { return std::move(waiter_.item); }
+
+    AsyncPop(const AsyncPop&) = delete;
+    AsyncPop& operator=(const AsyncPop&) = delete;
+
+private:
+    EventQueue& queue_;
+    std::optional<std::chrono::steady_clock::duration> timeout_;
+    AsyncWaiter waiter_;
+};
+
+// Awaitable returned by async_push
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+class EventQueue<T, Allocator, Backend, Metrics>::AsyncPush {
+public:
+    template<typename Executor>
+    AsyncPush(EventQueue& queue, Executor& executor, T&& item) : queue_(queue) {
+        waiter_.executor = &executor;
+        waiter_.post = &EventQueue::post_resume<Executor>;
+        waiter_.item.emplace(std::move(item));
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+        waiter_.handle = handle;
+        return queue_.async_suspend_push(waiter_);
+    }
+
+    bool await_resume() noexcept { return waiter_.pushed; }
+
+    AsyncPush(const AsyncPush&) = delete;
+    AsyncPush& operator=(const AsyncPush&) = delete;
+
+private:
+    EventQueue& queue_;
+    AsyncWaiter waiter_;
+};
+
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+template<typename Executor>
+typename EventQueue<T, Allocator, Backend, Metrics>::AsyncPop
+EventQueue<T, Allocator, Backend, Metrics>::async_pop(Executor& executor) {
+    return AsyncPop(*this, executor, std::nullopt);
+}
+
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+template<typename Rep, typename Period, typename Executor>
+typename EventQueue<T, Allocator, Backend, Metrics>::AsyncPop
+EventQueue<T, Allocator, Backend, Metrics>::async_pop_for(const std::chrono::duration<Rep, Period>& timeout,
+                                                          Executor& executor) {
+    return AsyncPop(*this, executor, std::chrono::ceil<std::chrono::steady_clock::duration>(timeout));
+}
+
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+template<typename Executor>
+typename EventQueue<T, Allocator, Backend, Metrics>::AsyncPush
+EventQueue<T, Allocator, Backend, Metrics>::async_push(T item, Executor& executor) {
+    return AsyncPush(*this, executor, std::move(item));
+}
+
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+template<typename Executor>
+void EventQueue<T, Allocator, Backend, Metrics>::post_resume(void* executor, std::coroutine_handle<> handle) {
+    static_cast<Executor*>(executor)->post([handle] { handle.resume(); });
+}
+
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+void EventQueue<T, Allocator, Backend, Metrics>::async_link(AsyncList& list, AsyncWaiter* waiter) noexcept {
+    waiter->prev = list.tail;
+    waiter->next = nullptr;
+    if (list.tail) {
+        list.tail->next = waiter;
+    } else {
+        list.head = waiter;
+    }
+    list.tail = waiter;
+}
+
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+void EventQueue<T, Allocator, Backend, Metrics>::async_unlink(AsyncList& list, AsyncWaiter* waiter) noexcept {
+    if (waiter->prev) {
+        waiter->prev->next = waiter->next;
+    } else {
+        list.head = waiter->next;
+    }
+    if (waiter->next) {
+        waiter->next->prev = waiter->prev;
+    } else {
+        list.tail = waiter->prev;
+    }
+    waiter->prev = waiter->next = nullptr;
+}
+
+// Unlinks and returns the oldest waiter whose claim we win. Waiters claimed
+// by a firing timeout are skipped; async_expire unlinks them.
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+typename EventQueue<T, Allocator, Backend, Metrics>::AsyncWaiter*
+EventQueue<T, Allocator, Backend, Metrics>::async_claim(AsyncList& list) noexcept {
+    for (AsyncWaiter* waiter = list.head; waiter; waiter = waiter->next) {
+        if (waiter->claimed->exchange(true, std::memory_order_acq_rel)) continue;
+        async_unlink(list, waiter);
+        if (waiter->timer) async_timers().cancel(waiter->timer);
+        return waiter;
+    }
+    return nullptr;
+}
+
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+void EventQueue<T, Allocator, Backend, Metrics>::async_complete(AsyncWaiter* waiter) {
+    waiter->post(waiter->executor, waiter->handle);
+}
+
+// One thread fires the async_pop_for timeouts of every queue
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+TimerEventQueue<std::function<void()>>& EventQueue<T, Allocator, Backend, Metrics>::async_timers() {
+    struct Timers {
+        TimerEventQueue<std::function<void()>> queue;
+        std::thread thread{[this] {
+            while (auto callback = queue.pop()) (*callback)();
+        }};
+
+        ~Timers() {
+            queue.close();
+            thread.join();
+        }
+    };
+    static Timers timers;
+    return timers.queue;
+}
+
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+bool EventQueue<T, Allocator, Backend, Metrics>::async_suspend_pop(AsyncWaiter& waiter,
+                                                                   const std::chrono::steady_clock::duration* timeout) {
+    auto lock = lock_queue();
+
+    if (!queue_.empty()) {
+        waiter.item.emplace(std::move(queue_.front()));
+        pop_locked();
+        notify(not_full_, waiting_producers_, 1);
+        serve_async_locked();
+        return false;
+    }
+    if (closed_ || (timeout && *timeout <= std::chrono::steady_clock::duration::zero())) return false;
+
+    if (timeout) {
+        auto state = std::make_shared<AsyncTimeout>();
+        state->queue = this;
+        state->waiter = &waiter;
+        waiter.timeout = state;
+        waiter.claimed = &state->claimed;
+        waiter.timer = async_timers().push_after([state] {
+            if (!state->claimed.exchange(true, std::memory_order_acq_rel)) {
+                state->queue->async_expire(state->waiter);
+            }
+        }, *timeout);
+    }
+    async_link(async_pops_, &waiter);
+    return true;
+}
+
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+bool EventQueue<T, Allocator, Backend, Metrics>::async_suspend_push(AsyncWaiter& waiter) {
+    auto lock = lock_queue();
+
+    if (closed_) return false;
+    if (max_size_ == 0 || queue_.size() < max_size_) {
+        push_locked(std::move(*waiter.item));
+        waiter.pushed = true;
+        notify(not_empty_, waiting_consumers_, 1);
+        serve_async_locked();
+        return false;
+    }
+
+    async_link(async_pushes_, &waiter);
+    return true;
+}
+
+// Timeout callback that won the claim: the waiter is still linked, so the
+// queue's destructor is waiting for us.
+template<typename T, typename Allocator, typename Backend, typename Metrics>
+void EventQueue<T, Allocator, Backend, Metrics>::async_expire(AsyncWaiter* waiter) {
+    auto lock = lock_queue();
+    async_unlink(async_pops_, waiter);
+    async_complete(waiter);
+    not_empty_.notify_all();
+}
+#endif
+
+// Lets threads sleep until some condition they poll for may have changed.
+// Waiters announce themselves before re-checking the condition, so
+// notify_all only takes the mutex when somebody is (about to be) asleep and
+// the uncontended path costs a fence and a load.
+class EventCount {
+public:
+    using Key = uint64_t;
+
+    // Registers the caller as a waiter. Re-check the condition afterwards,
+    // then either wait(key) or cancel_wait().
+    Key prepare_wait() noexcept;
+
+    void cancel_wait() noexcept;
+
+    // Sleeps until a notify call wakes it after prepare_wait returned key.
+    void wait(Key key);
+
+    // Like wait, but returns false once deadline has passed.
+    template<typename Clock, typename Duration>
+    bool wait_until(Key key, const std::chrono::time_point<Clock, Duration>& deadline);
+
+    // Call after making the condition true
+    void notify_all() noexcept;
+
+    // Like notify_all, but only guaranteed to wake one sleeping waiter (plus
+    // any waiter that has not gone to sleep yet). For conditions that a
+    // single waiter can act on.
+    void notify_one() noexcept;
+
+private:
+    std::atomic<Key> epoch_{0};
+    std::atomic<uint32_t> waiters_{0};
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
+// Bounded queue with lock-free push and pop (per-slot sequence numbers, as in
+// MpmcRing) and EventCount-based blocking. max_size is rounded up to a power
+// of two and all slots are allocated up front. Items pushed concurrently with
+// close() may be left in the queue for clear() or the destructor. Items are
+// constructed before a slot is claimed and moved in and out of it, so T's
+// move constructor must not throw. A single push or pop wakes one blocked
+// thread on the other side; push_range and close() wake them all.
+template<typename T, typename Allocator, typename Metrics>
+class EventQueue<T, Allocator, LockFreeBounded, Metrics> {
+    static_assert(!Metrics::enabled, "Queue metrics are only recorded by the mutex backend");
+    static_assert(std::is_nothrow_move_constructible<T>::value,
+                  "LockFreeBounded EventQueue needs a nothrow move constructor");
+
+public:
+    using allocator_type = Allocator;
+
+    explicit EventQueue(size_t max_size, const Allocator& alloc = Allocator());
+    ~EventQueue();
+
+    bool push(const T& item);
+    bool push(T&& item);
+
+    template<typename... Args>
+    bool emplace(Args&&... args);
+
+    template<typename InputIt>
+    size_t push_range(InputIt first, InputIt last);
+
+    size_t push_bulk(std::vector<T>&& items);
+
+    // Like push, but returns false instead of waiting when the queue is full.
+    bool try_push(const T& item);
+
+    std::optional<T> pop();
+    std::optional<T> try_pop();
+
+    template<typename Rep, typename Period>
+    std::optional<T> pop_for(const std::chrono::duration<Rep, Period>& timeout);
+
+    template<typename Clock, typename Duration>
+    std::optional<T> pop_until(const std::chrono::time_point<Clock, Duration>& deadline);
+
+    template<typename OutputIt>
+    size_t pop_batch(OutputIt out, size_t max_items);
+
+    template<typename OutputIt, typename Rep, typename Period>
+    size_t drain_for(OutputIt out, size_t max_items, const std::chrono::duration<Rep, Period>& timeout);
+
+    void close();
+    bool is_closed() const;
+    size_t size() const;
+    bool empty() const;
+    void clear();
+
+    // Non-copyable, non-movable
+    EventQueue(const EventQueue&) = delete;
+    EventQueue& operator=(const EventQueue&) = delete;
+    EventQueue(EventQueue&&) = delete;
+    EventQueue& operator=(EventQueue&&) = delete;
+
+private:
+    static constexpr size_t cache_line = 64;
+
+    struct Slot {
+        std::atomic<size_t> seq;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    using SlotAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Slot>;
+
+    // Moves item into the next free slot, or leaves it alone and returns
+    // false if the queue is full
+    bool try_place(T& item) noexcept;
+
+    template<typename Deadline>
+    std::optional<T> pop_wait(const Deadline* deadline);
+
+    SlotAllocator alloc_;
+    Slot* slots_;
+    size_t mask_;
+    std::atomic<bool> closed_{false};
+    EventCount not_empty_;
+    EventCount not_full_;
+    alignas(cache_line) std::atomic<size_t> enqueue_pos_{0};
+    alignas(cache_line) std::atomic<size_t> dequeue_pos_{0};
+};
+
 template<typename T>
-void EventQueue<T>::clear() {
-    std::lock_guard<std::mutex> lock(mutex_);
-    std::queue<T> empty;
-    std::swap(queue_, empty);
+using LockFreeEventQueue = EventQueue<T, std::allocator<T>, LockFreeBounded>;
+
+// Implementation
+inline EventCount::Key EventCount::prepare_wait() noexcept {
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+    Key key = epoch_.load(std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return key;
+}
+
+inline void EventCount::cancel_wait() noexcept {
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+inline void EventCount::wait(Key key) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&] { return epoch_.load(std::memory_order_relaxed) != key; });
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+template<typename Clock, typename Duration>
+bool EventCount::wait_until(Key key, const std::chrono::time_point<Clock, Duration>& deadline) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    bool woken = cv_.wait_until(lock, deadline, [&] {
+        return epoch_.load(std::memory_order_relaxed) != key;
+    });
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+    return woken;
+}
+
+inline void EventCount::notify_all() noexcept {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_relaxed) == 0) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        epoch_.fetch_add(1, std::memory_order_relaxed);
+    }
+    cv_.notify_all();
+}
+
+inline void EventCount::notify_one() noexcept {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_relaxed) == 0) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        epoch_.fetch_add(1, std::memory_order_relaxed);
+    }
+    cv_.notify_one();
+}
+
+template<typename T, typename Allocator, typename Metrics>
+EventQueue<T, Allocator, LockFreeBounded, Metrics>::EventQueue(size_t max_size, const Allocator& alloc)
+    : alloc_(alloc) {
+    if (max_size == 0 || max_size > (SIZE_MAX >> 1) + 1) {
+        throw std::invalid_argument("LockFreeBounded EventQueue needs 0 < max_size <= SIZE_MAX / 2 + 1");
+    }
+
+    size_t capacity = 2;
+    while (capacity < max_size) capacity <<= 1;
+
+    slots_ = std::allocator_traits<SlotAllocator>::allocate(alloc_, capacity);
+    mask_ = capacity - 1;
+    for (size_t i = 0; i < capacity; i++) {
+        new (&slots_[i].seq) std::atomic<size_t>(i);
+    }
+}
+
+template<typename T, typename Allocator, typename Metrics>
+EventQueue<T, Allocator, LockFreeBounded, Metrics>::~EventQueue() {
+    close();
+    clear();
+    std::allocator_traits<SlotAllocator>::deallocate(alloc_, slots_, mask_ + 1);
+}
+
+template<typename T, typename Allocator, typename Metrics>
+bool EventQueue<T, Allocator, LockFreeBounded, Metrics>::try_place(T& item) noexcept {
+    Slot* slot;
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+        slot = &slots_[pos & mask_];
+        size_t seq = slot->seq.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = enqueue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    // Nothing may throw between the claim and the publish: consumers wait
+    // for this slot before they look at any later one
+    new (slot->storage) T(std::move(item));
+    slot->seq.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+template<typename T, typename Allocator, typename Metrics>
+std::optional<T> EventQueue<T, Allocator, LockFreeBounded, Metrics>::try_pop() {
+    Slot* slot;
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+        slot = &slots_[pos & mask_];
+        size_t seq = slot->seq.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            return std::nullopt;
+        } else {
+            pos = dequeue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    T* stored = std::launder(reinterpret_cast<T*>(slot->storage));
+    std::optional<T> item(std::move(*stored));
+    stored->~T();
+    slot->seq.store(pos + mask_ + 1, std::memory_order_release);
+    not_full_.notify_one();
+    return item;
+}
+
+template<typename T, typename Allocator, typename Metrics>
+bool EventQueue<T, Allocator, LockFreeBounded, Metrics>::push(const T& item) {
+    return emplace(item);
+}
+
+template<typename T, typename Allocator, typename Metrics>
+bool EventQueue<T, Allocator, LockFreeBounded, Metrics>::push(T&& item) {
+    return emplace(std::move(item));
+}
+
+template<typename T, typename Allocator, typename Metrics>
+bool EventQueue<T, Allocator, LockFreeBounded, Metrics>::try_push(const T& item) {
+    if (closed_.load(std::memory_order_acquire)) return false;
+    T copy(item);
+    if (!try_place(copy)) return false;
+    not_empty_.notify_one();
+    return true;
+}
+
+template<typename T, typename Allocator, typename Metrics>
+template<typename... Args>
+bool EventQueue<T, Allocator, LockFreeBounded, Metrics>::emplace(Args&&... args) {
+    if (closed_.load(std::memory_order_acquire)) return false;
+    T item(std::forward<Args>(args)...);
+    for (;;) {
+        if (closed_.load(std::memory_order_acquire)) return false;
+        if (try_place(item)) {
+            not_empty_.notify_one();
+            return true;
+        }
+
+        // Full: sleep unless a slot was freed (or the queue closed) meanwhile
+        EventCount::Key key = not_full_.prepare_wait();
+        if (closed_.load(std::memory_order_acquire) || size() <= mask_) {
+            not_full_.cancel_wait();
+            continue;
+        }
+        not_full_.wait(key);
+    }
+}
+
+template<typename T, typename Allocator, typename Metrics>
+template<typename InputIt>
+size_t EventQueue<T, Allocator, LockFreeBounded, Metrics>::push_range(InputIt first, InputIt last) {
+    size_t pushed = 0;
+    size_t unannounced = 0;
+    for (; first != last; ++first) {
+        if (closed_.load(std::memory_order_acquire)) break;
+        T item(*first);
+        if (try_place(item)) {
+            unannounced++;
+        } else {
+            // Wake consumers for what is queued before blocking for space
+            if (unannounced > 0) not_empty_.notify_all();
+            unannounced = 0;
+            if (!emplace(std::move(item))) break;
+        }
+        pushed++;
+    }
+    if (unannounced > 0) not_empty_.notify_all();
+    return pushed;
+}
+
+template<typename T, typename Allocator, typename Metrics>
+size_t EventQueue<T, Allocator, LockFreeBounded, Metrics>::push_bulk(std::vector<T>&& items) {
+    size_t pushed = push_range(std::make_move_iterator(items.begin()),
+                               std::make_move_iterator(items.end()));
+    items.erase(items.begin(), items.begin() + pushed);
+    return pushed;
+}
+
+template<typename T, typename Allocator, typename Metrics>
+template<typename Deadline>
+std::optional<T> EventQueue<T, Allocator, LockFreeBounded, Metrics>::pop_wait(const Deadline* deadline) {
+    for (;;) {
+        if (auto item = try_pop()) return item;
+
+        EventCount::Key key = not_empty_.prepare_wait();
+        if (auto item = try_pop()) {
+            not_empty_.cancel_wait();
+            return item;
+        }
+        if (closed_.load(std::memory_order_acquire)) {
+            not_empty_.cancel_wait();
+            return try_pop();
+        }
+
+        if (!deadline) {
+            not_empty_.wait(key);
+        } else if (!not_empty_.wait_until(key, *deadline)) {
+            return try_pop();
+        }
+    }
+}
+
+template<typename T, typename Allocator, typename Metrics>
+std::optional<T> EventQueue<T, Allocator, LockFreeBounded, Metrics>::pop() {
+    return pop_wait<std::chrono::steady_clock::time_point>(nullptr);
+}
+
+template<typename T, typename Allocator, typename Metrics>
+template<typename Rep, typename Period>
+std::optional<T> EventQueue<T, Allocator, LockFreeBounded, Metrics>::pop_for(const std::chrono::duration<Rep, Period>& timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    return pop_wait(&deadline);
+}
+
+template<typename T, typename Allocator, typename Metrics>
+template<typename Clock, typename Duration>
+std::optional<T> EventQueue<T, Allocator, LockFreeBounded, Metrics>::pop_until(const std::chrono::time_point<Clock, Duration>& deadline) {
+    return pop_wait(&deadline);
+}
+
+template<typename T, typename Allocator, typename Metrics>
+template<typename OutputIt>
+size_t EventQueue<T, Allocator, LockFreeBounded, Metrics>::pop_batch(OutputIt out, size_t max_items) {
+    if (max_items == 0) return 0;
+    auto first = pop();
+    if (!first) return 0;
+
+    *out = std::move(*first);
+    ++out;
+    size_t taken = 1;
+    while (taken < max_items) {
+        auto item = try_pop();
+        if (!item) break;
+        *out = std::move(*item);
+        ++out;
+        ++taken;
+    }
+    return taken;
+}
+
+template<typename T, typename Allocator, typename Metrics>
+template<typename OutputIt, typename Rep, typename Period>
+size_t EventQueue<T, Allocator, LockFreeBounded, Metrics>::drain_for(OutputIt out, size_t max_items,
+                                                                     const std::chrono::duration<Rep, Period>& timeout) {
+    if (max_items == 0) return 0;
+    auto first = pop_for(timeout);
+    if (!first) return 0;
+
+    *out = std::move(*first);
+    ++out;
+    size_t taken = 1;
+    while (taken < max_items) {
+        auto item = try_pop();
+        if (!item) break;
+        *out = std::move(*item);
+        ++out;
+        ++taken;
+    }
+    return taken;
+}
+
+template<typename T, typename Allocator, typename Metrics>
+void EventQueue<T, Allocator, LockFreeBounded, Metrics>::close() {
+    closed_.store(true, std::memory_order_release);
+    not_empty_.notify_all();
     not_full_.notify_all();
 }
 
+template<typename T, typename Allocator, typename Metrics>
+bool EventQueue<T, Allocator, LockFreeBounded, Metrics>::is_closed() const {
+    return closed_.load(std::memory_order_acquire);
+}
+
+template<typename T, typename Allocator, typename Metrics>
+size_t EventQueue<T, Allocator, LockFreeBounded, Metrics>::size() const {
+    size_t dequeue = dequeue_pos_.load(std::memory_order_acquire);
+    size_t enqueue = enqueue_pos_.load(std::memory_order_acquire);
+    size_t used = enqueue - dequeue;
+    return used <= mask_ + 1 ? used : mask_ + 1;
+}
+
+template<typename T, typename Allocator, typename Metrics>
+bool EventQueue<T, Allocator, LockFreeBounded, Metrics>::empty() const {
+    return size() == 0;
+}
+
+template<typename T, typename Allocator, typename Metrics>
+void EventQueue<T, Allocator, LockFreeBounded, Metrics>::clear() {
+    while (try_pop()) {
+    }
+}
+
 #endif // EVENT_QUEUE_HPP
@@ -0,0 +1,99 @@
+// event_queue_latency.cpp
+//
+// Latency benchmark for EventQueue's backends under contention. Producers
+// push items stamped with the time of the push, consumers pop them, and the
+// push-to-pop latencies of all items are reported as p50/p99/p999/max. With
+// an interval the producers pace themselves, so the handoff is measured
+// rather than the backlog of a queue kept full.
+//
+//   c++ -std=c++17 -O2 -pthread event_queue_latency.cpp -o event_queue_latency
+//   ./event_queue_latency [producers] [consumers] [items_per_producer] [slots] [interval_ns]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "event_queue.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+struct Stamp {
+    Clock::time_point pushed;
+};
+
+static uint64_t ns_between(Clock::time_point from, Clock::time_point to) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+}
+
+// Sorts samples and prints one line of percentiles
+static void report(const char* name, const char* what, std::vector<uint64_t>& samples) {
+    if (samples.empty()) return;
+    std::sort(samples.begin(), samples.end());
+    auto at = [&](double q) { return samples[static_cast<size_t>(q * static_cast<double>(samples.size() - 1))]; };
+    std::printf("%-22s %-10s p50 %8.2f us  p99 %8.2f us  p999 %8.2f us  max %9.2f us\n", name, what,
+                at(0.5) / 1e3, at(0.99) / 1e3, at(0.999) / 1e3, static_cast<double>(samples.back()) / 1e3);
+}
+
+template<typename Backend>
+static void run(const char* name, uint32_t producers, uint32_t consumers, uint32_t per_producer, size_t slots,
+                std::chrono::nanoseconds interval) {
+    EventQueue<Stamp, std::allocator<Stamp>, Backend> queue(slots);
+    std::vector<std::vector<uint64_t>> push_ns(producers), latency_ns(consumers);
+    std::vector<std::thread> producer_threads, consumer_threads;
+
+    for (uint32_t c = 0; c < consumers; c++) {
+        latency_ns[c].reserve(static_cast<size_t>(producers) * per_producer / consumers + 1);
+        consumer_threads.emplace_back([&, c] {
+            while (auto item = queue.pop()) latency_ns[c].push_back(ns_between(item->pushed, Clock::now()));
+        });
+    }
+    for (uint32_t p = 0; p < producers; p++) {
+        push_ns[p].reserve(per_producer);
+        producer_threads.emplace_back([&, p] {
+            Clock::time_point next = Clock::now();
+            for (uint32_t i = 0; i < per_producer; i++) {
+                if (interval.count() > 0) {
+                    next += interval;
+                    while (Clock::now() < next) std::this_thread::yield();
+                }
+                Clock::time_point start = Clock::now();
+                queue.push(Stamp{start});
+                push_ns[p].push_back(ns_between(start, Clock::now()));
+            }
+        });
+    }
+
+    for (auto& t : producer_threads) t.join();
+    queue.close();
+    for (auto& t : consumer_threads) t.join();
+
+    std::vector<uint64_t> pushes, latencies;
+    for (auto& v : push_ns) pushes.insert(pushes.end(), v.begin(), v.end());
+    for (auto& v : latency_ns) latencies.insert(latencies.end(), v.begin(), v.end());
+    report(name, "push call", pushes);
+    report(name, "push->pop", latencies);
+}
+
+int main(int argc, char** argv) {
+    uint32_t producers = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 4;
+    uint32_t consumers = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 4;
+    uint32_t per_producer = argc > 3 ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)) : 200000;
+    size_t slots = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 1024;
+    std::chrono::nanoseconds interval(argc > 5 ? std::strtoull(argv[5], nullptr, 10) : 0);
+    if (producers == 0 || consumers == 0 || per_producer == 0 || slots == 0) {
+        std::fprintf(stderr, "usage: %s [producers] [consumers] [items_per_producer] [slots] [interval_ns]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    std::printf("%ux%u, %u items per producer, %zu slots, interval %lld ns, %u hardware threads\n", producers,
+                consumers, per_producer, slots, static_cast<long long>(interval.count()),
+                std::thread::hardware_concurrency());
+    run<MutexBackend>("EventQueue<Mutex>", producers, consumers, per_producer, slots, interval);
+    run<LockFreeBounded>("EventQueue<LockFree>", producers, consumers, per_producer, slots, interval);
+    return 0;
+}
@@ -0,0 +1,164 @@
+// event_queue_throughput.cpp
+//
+// C++ twin of ring_mpmc_stress.c: the same tagged-item workload through
+// MpmcRing and through EventQueue with both backends, so their throughput
+// can be compared on one machine. Every item must be seen exactly once.
+//
+//   cc -std=gnu11 -O2 -c ring_buffer.c
+//   c++ -std=c++17 -O2 -pthread event_queue_throughput.cpp ring_buffer.o -o event_queue_throughput
+//   ./event_queue_throughput [producers] [consumers] [items_per_producer] [slots]
+//
+// Exits with status 1 if an item was lost or duplicated.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "event_queue.hpp"
+
+// ring_buffer.h relies on C11 atomics, so only the MpmcRing calls are declared
+extern "C" {
+typedef struct MpmcRing MpmcRing;
+MpmcRing* ring_mpmc_create(size_t slot_size, size_t slot_count);
+void ring_mpmc_destroy(MpmcRing* ring);
+bool ring_mpmc_push(MpmcRing* ring, const void* data);
+bool ring_mpmc_pop(MpmcRing* ring, void* data);
+}
+
+struct Item {
+    uint32_t producer;
+    uint32_t seq;
+    uint64_t payload;     // Bytes that must arrive intact along with the tag
+};
+
+static uint64_t payload_of(uint32_t producer, uint32_t seq) {
+    return (static_cast<uint64_t>(producer) << 32 | seq) * 0x9e3779b97f4a7c15ULL;
+}
+
+class Tally {
+public:
+    Tally(uint32_t producers, uint32_t per_producer)
+        : producers_(producers), per_producer_(per_producer),
+          seen_(new std::atomic<unsigned>[static_cast<size_t>(producers) * per_producer]()) {}
+
+    void record(const Item& item) {
+        if (item.producer >= producers_ || item.seq >= per_producer_ ||
+            item.payload != payload_of(item.producer, item.seq)) {
+            corrupt_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        seen_[static_cast<size_t>(item.producer) * per_producer_ + item.seq].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Prints one result line; returns false if anything went missing
+    bool report(const char* name, uint32_t consumers, double elapsed) const {
+        size_t total = static_cast<size_t>(producers_) * per_producer_;
+        size_t lost = 0, duplicated = 0;
+        for (size_t i = 0; i < total; i++) {
+            unsigned n = seen_[i].load(std::memory_order_relaxed);
+            if (n == 0) lost++;
+            if (n > 1) duplicated++;
+        }
+        unsigned long corrupt = corrupt_.load(std::memory_order_relaxed);
+        std::printf("%-22s %ux%u: %zu items in %.3f s (%.1f M items/s), lost %zu, duplicated %zu, corrupt %lu\n",
+                    name, producers_, consumers, total, elapsed, static_cast<double>(total) / elapsed / 1e6,
+                    lost, duplicated, corrupt);
+        return lost == 0 && duplicated == 0 && corrupt == 0;
+    }
+
+private:
+    uint32_t producers_;
+    uint32_t per_producer_;
+    std::unique_ptr<std::atomic<unsigned>[]> seen_;
+    std::atomic<unsigned long> corrupt_{0};
+};
+
+// Starts the producers and consumers, joins them and returns the seconds taken.
+// close() runs once every producer is done.
+template<typename Produce, typename Consume, typename Close>
+static double run(uint32_t producers, uint32_t consumers, Produce produce, Consume consume, Close close) {
+    std::vector<std::thread> producer_threads, consumer_threads;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < consumers; i++) consumer_threads.emplace_back(consume);
+    for (uint32_t i = 0; i < producers; i++) producer_threads.emplace_back(produce, i);
+    for (auto& t : producer_threads) t.join();
+    close();
+    for (auto& t : consumer_threads) t.join();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool run_ring(uint32_t producers, uint32_t consumers, uint32_t per_producer, size_t slots) {
+    Tally tally(producers, per_producer);
+    MpmcRing* ring = ring_mpmc_create(sizeof(Item), slots);
+    if (!ring) {
+        std::fprintf(stderr, "allocation failed\n");
+        std::exit(2);
+    }
+    std::atomic<bool> done{false};
+
+    double elapsed = run(
+        producers, consumers,
+        [&](uint32_t id) {
+            for (uint32_t i = 0; i < per_producer; i++) {
+                Item item{id, i, payload_of(id, i)};
+                while (!ring_mpmc_push(ring, &item)) std::this_thread::yield();
+            }
+        },
+        [&] {
+            Item item;
+            for (;;) {
+                if (ring_mpmc_pop(ring, &item)) {
+                    tally.record(item);
+                } else if (done.load(std::memory_order_acquire)) {
+                    // Producers are done: whatever is left can be drained without waiting
+                    if (!ring_mpmc_pop(ring, &item)) return;
+                    tally.record(item);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        },
+        [&] { done.store(true, std::memory_order_release); });
+
+    ring_mpmc_destroy(ring);
+    return tally.report("MpmcRing", consumers, elapsed);
+}
+
+template<typename Backend>
+static bool run_queue(const char* name, uint32_t producers, uint32_t consumers, uint32_t per_producer,
+                      size_t slots) {
+    Tally tally(producers, per_producer);
+    EventQueue<Item, std::allocator<Item>, Backend> queue(slots);
+
+    double elapsed = run(
+        producers, consumers,
+        [&](uint32_t id) {
+            for (uint32_t i = 0; i < per_producer; i++) queue.push(Item{id, i, payload_of(id, i)});
+        },
+        [&] {
+            while (auto item = queue.pop()) tally.record(*item);
+        },
+        [&] { queue.close(); });
+
+    return tally.report(name, consumers, elapsed);
+}
+
+int main(int argc, char** argv) {
+    uint32_t producers = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 4;
+    uint32_t consumers = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 4;
+    uint32_t per_producer = argc > 3 ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)) : 1000000;
+    size_t slots = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 1024;
+    if (producers == 0 || consumers == 0 || per_producer == 0 || slots == 0) {
+        std::fprintf(stderr, "usage: %s [producers] [consumers] [items_per_producer] [slots]\n", argv[0]);
+        return 2;
+    }
+
+    bool ok = run_ring(producers, consumers, per_producer, slots);
+    ok = run_queue<MutexBackend>("EventQueue<Mutex>", producers, consumers, per_producer, slots) && ok;
+    ok = run_queue<LockFreeBounded>("EventQueue<LockFree>", producers, consumers, per_producer, slots) && ok;
+    return ok ? 0 : 1;
+}
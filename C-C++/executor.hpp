@@ -0,0 +1,295 @@
+// executor.hpp
+#ifndef EXECUTOR_HPP
+#define EXECUTOR_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+#include "event_queue.hpp"
+
+// Thread pool in which every worker owns a deque of tasks. A worker runs its
+// own tasks newest first and, when it runs dry, takes from the shared
+// submission queue or steals the oldest task of another worker, so workers
+// only contend when one of them is out of work.
+//
+// Tasks posted from outside the pool go through an EventQueue; tasks posted
+// by a running task go straight to its worker's deque. close() has
+// EventQueue semantics: further posts from outside fail, everything already
+// queued (and anything it spawns) still runs, then the workers exit.
+class WorkStealingExecutor {
+public:
+    using Task = std::function<void()>;
+
+    // Starts threads workers (hardware_concurrency() if 0).
+    explicit WorkStealingExecutor(size_t threads = 0);
+
+    // Closes the executor and waits for the queued tasks to finish.
+    ~WorkStealingExecutor();
+
+    // Queues task. Returns false if the executor is closed and the caller
+    // isn't one of its tasks. A task that throws terminates the program;
+    // use submit to get exceptions back.
+    bool post(Task task);
+
+    // Runs f(args...) on the pool. The future carries the result or the
+    // exception. Throws std::runtime_error if the executor is closed.
+    template<typename F, typename... Args>
+    auto submit(F&& f, Args&&... args)
+        -> std::future<std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>>;
+
+    // Calls fn(i) for every i in [begin, end), in chunks of grain indices
+    // (an even split over the workers if 0). The calling thread takes part,
+    // so this may also be used from inside a task. Rethrows the first
+    // exception thrown by fn once every started chunk has finished.
+    template<typename Index, typename Fn>
+    void parallel_for(Index begin, Index end, Fn&& fn, size_t grain = 0);
+
+    // Stops accepting outside work; workers exit once everything queued has run.
+    void close();
+    bool is_closed() const;
+
+    // Closes the executor and waits for every worker to exit. Must not be
+    // called from one of its tasks.
+    void join();
+
+    size_t thread_count() const noexcept;
+
+    // Non-copyable, non-movable
+    WorkStealingExecutor(const WorkStealingExecutor&) = delete;
+    WorkStealingExecutor& operator=(const WorkStealingExecutor&) = delete;
+    WorkStealingExecutor(WorkStealingExecutor&&) = delete;
+    WorkStealingExecutor& operator=(WorkStealingExecutor&&) = delete;
+
+private:
+    struct alignas(64) WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    // The executor and worker the calling thread belongs to, if any
+    static inline thread_local WorkStealingExecutor* current_executor_ = nullptr;
+    static inline thread_local size_t current_index_ = 0;
+
+    bool enqueue(Task&& task);
+    void wake(size_t tasks) noexcept;
+    void worker_loop(size_t index);
+    bool find_task(size_t index, Task& task);
+    bool steal(size_t thief, Task& task);
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues_;
+    std::vector<std::thread> threads_;
+    EventQueue<Task> submissions_;
+    EventCount idle_;
+    std::mutex join_mutex_;
+};
+
+// Implementation
+inline WorkStealingExecutor::WorkStealingExecutor(size_t threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (size_t i = 0; i < threads; i++) {
+        queues_.push_back(std::make_unique<WorkerQueue>());
+    }
+    threads_.reserve(threads);
+    for (size_t i = 0; i < threads; i++) {
+        threads_.emplace_back(&WorkStealingExecutor::worker_loop, this, i);
+    }
+}
+
+inline WorkStealingExecutor::~WorkStealingExecutor() {
+    join();
+}
+
+inline bool WorkStealingExecutor::post(Task task) {
+    if (!enqueue(std::move(task))) return false;
+    wake(1);
+    return true;
+}
+
+// Queues task without waking anyone
+inline bool WorkStealingExecutor::enqueue(Task&& task) {
+    if (current_executor_ == this) {
+        WorkerQueue& queue = *queues_[current_index_];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+        return true;
+    }
+    return submissions_.push(std::move(task));
+}
+
+// Wakes one idle worker per new task, or all of them once there are at
+// least as many tasks as workers
+inline void WorkStealingExecutor::wake(size_t tasks) noexcept {
+    if (tasks >= threads_.size()) {
+        idle_.notify_all();
+        return;
+    }
+    for (size_t i = 0; i < tasks; i++) idle_.notify_one();
+}
+
+template<typename F, typename... Args>
+auto WorkStealingExecutor::submit(F&& f, Args&&... args)
+    -> std::future<std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>> {
+    using Result = std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>;
+
+    auto task = std::make_shared<std::packaged_task<Result()>>(
+        [f = std::forward<F>(f), args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+            return std::apply(std::move(f), std::move(args));
+        });
+    std::future<Result> result = task->get_future();
+    if (!post([task] { (*task)(); })) {
+        throw std::runtime_error("WorkStealingExecutor is closed");
+    }
+    return result;
+}
+
+template<typename Index, typename Fn>
+void WorkStealingExecutor::parallel_for(Index begin, Index end, Fn&& fn, size_t grain) {
+    if (!(begin < end)) return;
+
+    size_t count = static_cast<size_t>(end - begin);
+    if (grain == 0) grain = std::max<size_t>(1, count / (threads_.size() * 4));
+    size_t chunks = (count + grain - 1) / grain;
+
+    // Helpers may start after parallel_for has returned; they then find no
+    // chunk left to claim and never touch fn.
+    struct State {
+        std::atomic<size_t> next{0};
+        size_t done = 0;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto state = std::make_shared<State>();
+
+    auto run_chunks = [state, begin, end, grain, chunks, &fn] {
+        for (;;) {
+            size_t chunk = state->next.fetch_add(1, std::memory_order_relaxed);
+            if (chunk >= chunks) return;
+
+            std::exception_ptr error;
+            try {
+                Index first = begin + static_cast<Index>(chunk * grain);
+                Index last = chunk + 1 == chunks ? end : first + static_cast<Index>(grain);
+                for (Index i = first; i < last; ++i) fn(i);
+            } catch (...) {
+                error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (error && !state->error) state->error = error;
+            if (++state->done == chunks) state->finished.notify_all();
+        }
+    };
+
+    size_t helpers = std::min(threads_.size(), chunks - 1);
+    size_t queued = 0;
+    while (queued < helpers && enqueue(run_chunks)) queued++;
+    wake(queued);
+    run_chunks();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&] { return state->done == chunks; });
+    if (state->error) std::rethrow_exception(state->error);
+}
+
+inline void WorkStealingExecutor::close() {
+    submissions_.close();
+    idle_.notify_all();
+}
+
+inline bool WorkStealingExecutor::is_closed() const {
+    return submissions_.is_closed();
+}
+
+inline void WorkStealingExecutor::join() {
+    close();
+    std::lock_guard<std::mutex> lock(join_mutex_);
+    for (auto& thread : threads_) {
+        if (thread.joinable()) thread.join();
+    }
+}
+
+inline size_t WorkStealingExecutor::thread_count() const noexcept {
+    return threads_.size();
+}
+
+inline void WorkStealingExecutor::worker_loop(size_t index) {
+    current_executor_ = this;
+    current_index_ = index;
+    Task task;
+
+    for (;;) {
+        if (find_task(index, task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        // Re-check after registering as a waiter so a post racing with us
+        // either is seen here or wakes us.
+        EventCount::Key key = idle_.prepare_wait();
+        bool closed = submissions_.is_closed();
+        if (find_task(index, task)) {
+            idle_.cancel_wait();
+            task();
+            task = nullptr;
+            continue;
+        }
+        if (closed) {
+            idle_.cancel_wait();
+            break;
+        }
+        idle_.wait(key);
+    }
+
+    current_executor_ = nullptr;
+}
+
+// Own deque first (newest task, still warm in cache), then outside
+// submissions, then the other workers.
+inline bool WorkStealingExecutor::find_task(size_t index, Task& task) {
+    {
+        WorkerQueue& queue = *queues_[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            return true;
+        }
+    }
+
+    if (auto submitted = submissions_.try_pop()) {
+        task = std::move(*submitted);
+        return true;
+    }
+
+    return steal(index, task);
+}
+
+inline bool WorkStealingExecutor::steal(size_t thief, Task& task) {
+    for (size_t i = 1; i < queues_.size(); i++) {
+        WorkerQueue& victim = *queues_[(thief + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.tasks.empty()) continue;
+
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+#endif // EXECUTOR_HPP
@@ -0,0 +1,80 @@
+// flat_lru_bench.cpp
+//
+// FlatLRUCache against LRUCache at a capacity of 2^20 entries or more. Each
+// class is filled to capacity, then runs a hit-only phase and a mixed phase
+// over 25% more keys than fit, where every miss is followed by a put that
+// evicts. Times are per operation; the hit counts must match.
+//
+//   c++ -std=c++17 -O2 flat_lru_bench.cpp -o flat_lru_bench
+//   ./flat_lru_bench [log2_capacity] [ops]      (defaults 20 and 4 * capacity)
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "flat_lru_cache.hpp"
+#include "lru_cache.hpp"
+
+// splitmix64, so both classes see the same key sequence
+static uint64_t next_random(uint64_t& state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static double ns_per_op(std::chrono::steady_clock::time_point start, uint64_t ops) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+           static_cast<double>(ops);
+}
+
+template<typename Cache>
+static void bench(const char* name, size_t capacity, uint64_t ops) {
+    Cache cache(capacity);
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t k = 0; k < capacity; k++) cache.put(k, k);
+    double fill = ns_per_op(start, capacity);
+
+    uint64_t state = 1;
+    uint64_t checksum = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < ops; i++) {
+        if (auto v = cache.get(next_random(state) % capacity)) checksum += *v;
+    }
+    double hits = ns_per_op(start, ops);
+
+    uint64_t keys = capacity + capacity / 4;
+    uint64_t hit_count = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < ops; i++) {
+        uint64_t k = next_random(state) % keys;
+        if (auto v = cache.get(k)) {
+            checksum += *v;
+            hit_count++;
+        } else {
+            cache.put(k, k);
+        }
+    }
+    double mixed = ns_per_op(start, ops);
+
+    std::printf("%-14s fill %6.1f ns/put  hits %6.1f ns/get  mixed %6.1f ns/op (%llu hits)  checksum %llx\n", name,
+                fill, hits, mixed, static_cast<unsigned long long>(hit_count),
+                static_cast<unsigned long long>(checksum));
+}
+
+int main(int argc, char** argv) {
+    unsigned log2_capacity = argc > 1 ? static_cast<unsigned>(std::strtoul(argv[1], nullptr, 10)) : 20;
+    if (log2_capacity < 20 || log2_capacity > 30) {
+        std::fprintf(stderr, "usage: %s [log2_capacity 20..30] [ops]\n", argv[0]);
+        return 2;
+    }
+    size_t capacity = size_t(1) << log2_capacity;
+    uint64_t ops = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 4 * static_cast<uint64_t>(capacity);
+
+    std::printf("capacity %zu, %llu ops per phase\n", capacity, static_cast<unsigned long long>(ops));
+    bench<LRUCache<uint64_t, uint64_t>>("LRUCache", capacity, ops);
+    bench<FlatLRUCache<uint64_t, uint64_t>>("FlatLRUCache", capacity, ops);
+    return 0;
+}
@@ -0,0 +1,432 @@
+// flat_lru_cache.hpp
+#ifndef FLAT_LRU_CACHE_HPP
+#define FLAT_LRU_CACHE_HPP
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+// LRUCache with the same interface, laid out for a capacity fixed up front.
+// Entries live in one preallocated slot array and form the recency list
+// through 32-bit prev/next indices; lookups go through an open-addressing
+// table (linear probing, at most half full) of slot indices tagged with the
+// key's hash. Both arrays are allocated by the constructor, so nothing
+// allocates afterwards beyond what copying Key and Value does.
+template<typename Key, typename Value, typename Hash = std::hash<Key>,
+         typename Allocator = std::allocator<std::pair<const Key, Value>>>
+class FlatLRUCache {
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using value_type = std::pair<const Key, Value>;
+    using size_type = std::size_t;
+    using allocator_type = Allocator;
+
+    // capacity must be between 1 and 2^30.
+    explicit FlatLRUCache(size_type capacity);
+
+    // The slot array and hash table are allocated from (rebound copies of) alloc.
+    FlatLRUCache(size_type capacity, const Allocator& alloc);
+
+    FlatLRUCache(const FlatLRUCache& other);
+    // Leaves other empty with capacity 0: lookups miss and puts are dropped
+    // until something is assigned to it.
+    FlatLRUCache(FlatLRUCache&& other) noexcept;
+    FlatLRUCache& operator=(FlatLRUCache other) noexcept;
+    ~FlatLRUCache();
+
+    std::optional<Value> get(const Key& key);
+    void put(const Key& key, const Value& value);
+    void put(const Key& key, Value&& value);
+
+    // Returns the entry for key, or nullptr, without making it the most
+    // recently used. The pointer stays valid until the entry is removed.
+    const value_type* find(const Key& key) const;
+
+    // Makes key the most recently used entry. Returns false if it isn't cached.
+    bool promote(const Key& key);
+
+    bool contains(const Key& key) const;
+    bool erase(const Key& key);
+    void clear();
+    size_type size() const noexcept;
+    size_type capacity() const noexcept;
+    bool empty() const noexcept;
+
+    // Calls fn(key, value) from the newest entry to the oldest.
+    template<typename Func>
+    void for_each(Func&& fn) const;
+
+    std::optional<std::pair<Key, Value>> peek_oldest() const;
+    std::optional<std::pair<Key, Value>> peek_newest() const;
+
+private:
+    static constexpr uint32_t npos = UINT32_MAX;
+    static constexpr size_type max_capacity = size_type(1) << 30;
+
+    struct Slot {
+        alignas(value_type) unsigned char storage[sizeof(value_type)];
+        uint32_t prev;
+        uint32_t next;      // Also links the free list
+    };
+
+    struct Bucket {
+        uint32_t slot;      // npos if empty
+        uint32_t hash;      // Home bucket is hash & bucket_mask_
+    };
+
+    using Traits = std::allocator_traits<Allocator>;
+    using SlotAllocator = typename Traits::template rebind_alloc<Slot>;
+    using BucketAllocator = typename Traits::template rebind_alloc<Bucket>;
+
+    // Unchecked; capacity 0 allocates nothing
+    FlatLRUCache(size_type capacity, const Allocator& alloc, const Hash& hash);
+
+    value_type& entry(uint32_t slot) noexcept;
+    const value_type& entry(uint32_t slot) const noexcept;
+    uint32_t hash_of(const Key& key) const;
+    uint32_t find_bucket(const Key& key, uint32_t hash) const;
+
+    template<typename V>
+    void put_impl(const Key& key, V&& value);
+
+    void link_front(uint32_t slot) noexcept;
+    void unlink(uint32_t slot) noexcept;
+    void touch(uint32_t slot) noexcept;
+    void erase_bucket(uint32_t bucket) noexcept;
+    void remove(uint32_t bucket) noexcept;
+    void evict_oldest();
+
+    SlotAllocator slot_alloc_;
+    BucketAllocator bucket_alloc_;
+    Hash hash_;
+    Slot* slots_ = nullptr;
+    Bucket* buckets_ = nullptr;
+    size_type capacity_;
+    uint32_t bucket_mask_ = 0;
+    size_type size_ = 0;
+    uint32_t head_ = npos;      // Newest
+    uint32_t tail_ = npos;      // Oldest
+    uint32_t free_ = npos;      // Recycled slots
+    uint32_t unused_ = 0;       // Slots from here on have never been used
+};
+
+// Implementation
+template<typename Key, typename Value, typename Hash, typename Allocator>
+FlatLRUCache<Key, Value, Hash, Allocator>::FlatLRUCache(size_type capacity)
+    : FlatLRUCache(capacity, Allocator()) {}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+FlatLRUCache<Key, Value, Hash, Allocator>::FlatLRUCache(size_type capacity, const Allocator& alloc)
+    : FlatLRUCache((capacity == 0 || capacity > max_capacity)
+                       ? throw std::invalid_argument("FlatLRUCache capacity must be in [1, 2^30]")
+                       : capacity,
+                   alloc, Hash()) {}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+FlatLRUCache<Key, Value, Hash, Allocator>::FlatLRUCache(size_type capacity, const Allocator& alloc,
+                                                        const Hash& hash)
+    : slot_alloc_(alloc), bucket_alloc_(alloc), hash_(hash), capacity_(capacity) {
+    if (capacity == 0) return;
+
+    size_type buckets = 2;
+    while (buckets < capacity * 2) buckets <<= 1;
+    bucket_mask_ = static_cast<uint32_t>(buckets - 1);
+
+    slots_ = std::allocator_traits<SlotAllocator>::allocate(slot_alloc_, capacity);
+    try {
+        buckets_ = std::allocator_traits<BucketAllocator>::allocate(bucket_alloc_, buckets);
+    } catch (...) {
+        std::allocator_traits<SlotAllocator>::deallocate(slot_alloc_, slots_, capacity);
+        throw;
+    }
+    for (size_type i = 0; i < buckets; i++) buckets_[i].slot = npos;
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+FlatLRUCache<Key, Value, Hash, Allocator>::FlatLRUCache(const FlatLRUCache& other)
+    : FlatLRUCache(other.capacity_,
+                   Allocator(std::allocator_traits<SlotAllocator>::select_on_container_copy_construction(
+                       other.slot_alloc_)),
+                   other.hash_) {
+    for (uint32_t slot = other.tail_; slot != npos; slot = other.slots_[slot].prev) {
+        put(other.entry(slot).first, other.entry(slot).second);
+    }
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+FlatLRUCache<Key, Value, Hash, Allocator>::FlatLRUCache(FlatLRUCache&& other) noexcept
+    : slot_alloc_(other.slot_alloc_), bucket_alloc_(other.bucket_alloc_), hash_(other.hash_),
+      slots_(std::exchange(other.slots_, nullptr)), buckets_(std::exchange(other.buckets_, nullptr)),
+      capacity_(std::exchange(other.capacity_, 0)), bucket_mask_(std::exchange(other.bucket_mask_, 0)), size_(std::exchange(other.size_, 0)),
+      head_(std::exchange(other.head_, npos)), tail_(std::exchange(other.tail_, npos)),
+      free_(std::exchange(other.free_, npos)), unused_(std::exchange(other.unused_, 0)) {}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+FlatLRUCache<Key, Value, Hash, Allocator>&
+FlatLRUCache<Key, Value, Hash, Allocator>::operator=(FlatLRUCache other) noexcept {
+    using std::swap;
+    swap(slot_alloc_, other.slot_alloc_);
+    swap(bucket_alloc_, other.bucket_alloc_);
+    swap(hash_, other.hash_);
+    swap(slots_, other.slots_);
+    swap(buckets_, other.buckets_);
+    swap(capacity_, other.capacity_);
+    swap(bucket_mask_, other.bucket_mask_);
+    swap(size_, other.size_);
+    swap(head_, other.head_);
+    swap(tail_, other.tail_);
+    swap(free_, other.free_);
+    swap(unused_, other.unused_);
+    return *this;
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+FlatLRUCache<Key, Value, Hash, Allocator>::~FlatLRUCache() {
+    if (!slots_) return;  // Moved from
+    clear();
+    std::allocator_traits<BucketAllocator>::deallocate(bucket_alloc_, buckets_, size_type(bucket_mask_) + 1);
+    std::allocator_traits<SlotAllocator>::deallocate(slot_alloc_, slots_, capacity_);
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+typename FlatLRUCache<Key, Value, Hash, Allocator>::value_type&
+FlatLRUCache<Key, Value, Hash, Allocator>::entry(uint32_t slot) noexcept {
+    return *std::launder(reinterpret_cast<value_type*>(slots_[slot].storage));
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+const typename FlatLRUCache<Key, Value, Hash, Allocator>::value_type&
+FlatLRUCache<Key, Value, Hash, Allocator>::entry(uint32_t slot) const noexcept {
+    return *std::launder(reinterpret_cast<const value_type*>(slots_[slot].storage));
+}
+
+// Finalizer of MurmurHash3, so weak hashes (std::hash<int> is the identity)
+// still spread over the low bits used for the home bucket
+template<typename Key, typename Value, typename Hash, typename Allocator>
+uint32_t FlatLRUCache<Key, Value, Hash, Allocator>::hash_of(const Key& key) const {
+    uint64_t h = static_cast<uint64_t>(hash_(key));
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return static_cast<uint32_t>(h);
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+uint32_t FlatLRUCache<Key, Value, Hash, Allocator>::find_bucket(const Key& key, uint32_t hash) const {
+    if (!buckets_) return npos;  // Moved from
+    for (uint32_t i = hash & bucket_mask_;; i = (i + 1) & bucket_mask_) {
+        const Bucket& bucket = buckets_[i];
+        if (bucket.slot == npos) return npos;
+        if (bucket.hash == hash && std::equal_to<Key>()(entry(bucket.slot).first, key)) return i;
+    }
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+std::optional<Value> FlatLRUCache<Key, Value, Hash, Allocator>::get(const Key& key) {
+    uint32_t bucket = find_bucket(key, hash_of(key));
+    if (bucket == npos) {
+        return std::nullopt;
+    }
+    touch(buckets_[bucket].slot);
+    return entry(buckets_[bucket].slot).second;
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+void FlatLRUCache<Key, Value, Hash, Allocator>::put(const Key& key, const Value& value) {
+    put_impl(key, value);
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+void FlatLRUCache<Key, Value, Hash, Allocator>::put(const Key& key, Value&& value) {
+    put_impl(key, std::move(value));
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+template<typename V>
+void FlatLRUCache<Key, Value, Hash, Allocator>::put_impl(const Key& key, V&& value) {
+    uint32_t hash = hash_of(key);
+    uint32_t bucket = find_bucket(key, hash);
+    if (bucket != npos) {
+        entry(buckets_[bucket].slot).second = std::forward<V>(value);
+        touch(buckets_[bucket].slot);
+        return;
+    }
+
+    if (capacity_ == 0) return;  // Moved from
+    if (size_ >= capacity_) {
+        evict_oldest();
+    }
+
+    uint32_t slot = free_ != npos ? free_ : unused_;
+    ::new (static_cast<void*>(slots_[slot].storage)) value_type(key, std::forward<V>(value));
+    if (slot == free_) {
+        free_ = slots_[slot].next;
+    } else {
+        unused_++;
+    }
+
+    // The table is at most half full, so an empty bucket is never far
+    uint32_t i = hash & bucket_mask_;
+    while (buckets_[i].slot != npos) i = (i + 1) & bucket_mask_;
+    buckets_[i] = {slot, hash};
+    link_front(slot);
+    size_++;
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+const typename FlatLRUCache<Key, Value, Hash, Allocator>::value_type*
+FlatLRUCache<Key, Value, Hash, Allocator>::find(const Key& key) const {
+    uint32_t bucket = find_bucket(key, hash_of(key));
+    if (bucket == npos) {
+        return nullptr;
+    }
+    return &entry(buckets_[bucket].slot);
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+bool FlatLRUCache<Key, Value, Hash, Allocator>::promote(const Key& key) {
+    uint32_t bucket = find_bucket(key, hash_of(key));
+    if (bucket == npos) {
+        return false;
+    }
+    touch(buckets_[bucket].slot);
+    return true;
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+bool FlatLRUCache<Key, Value, Hash, Allocator>::contains(const Key& key) const {
+    return find_bucket(key, hash_of(key)) != npos;
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+bool FlatLRUCache<Key, Value, Hash, Allocator>::erase(const Key& key) {
+    uint32_t bucket = find_bucket(key, hash_of(key));
+    if (bucket == npos) {
+        return false;
+    }
+    remove(bucket);
+    return true;
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+void FlatLRUCache<Key, Value, Hash, Allocator>::clear() {
+    if (!slots_) return;  // Moved from
+    for (uint32_t slot = head_; slot != npos; slot = slots_[slot].next) {
+        entry(slot).~value_type();
+    }
+    for (size_type i = 0; i <= bucket_mask_; i++) buckets_[i].slot = npos;
+    size_ = 0;
+    head_ = tail_ = free_ = npos;
+    unused_ = 0;
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+typename FlatLRUCache<Key, Value, Hash, Allocator>::size_type
+FlatLRUCache<Key, Value, Hash, Allocator>::size() const noexcept {
+    return size_;
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+typename FlatLRUCache<Key, Value, Hash, Allocator>::size_type
+FlatLRUCache<Key, Value, Hash, Allocator>::capacity() const noexcept {
+    return capacity_;
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+bool FlatLRUCache<Key, Value, Hash, Allocator>::empty() const noexcept {
+    return size_ == 0;
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+template<typename Func>
+void FlatLRUCache<Key, Value, Hash, Allocator>::for_each(Func&& fn) const {
+    for (uint32_t slot = head_; slot != npos; slot = slots_[slot].next) {
+        fn(entry(slot).first, entry(slot).second);
+    }
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+std::optional<std::pair<Key, Value>> FlatLRUCache<Key, Value, Hash, Allocator>::peek_oldest() const {
+    if (tail_ == npos) return std::nullopt;
+    return entry(tail_);
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+std::optional<std::pair<Key, Value>> FlatLRUCache<Key, Value, Hash, Allocator>::peek_newest() const {
+    if (head_ == npos) return std::nullopt;
+    return entry(head_);
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+void FlatLRUCache<Key, Value, Hash, Allocator>::link_front(uint32_t slot) noexcept {
+    slots_[slot].prev = npos;
+    slots_[slot].next = head_;
+    if (head_ != npos) {
+        slots_[head_].prev = slot;
+    } else {
+        tail_ = slot;
+    }
+    head_ = slot;
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+void FlatLRUCache<Key, Value, Hash, Allocator>::unlink(uint32_t slot) noexcept {
+    uint32_t prev = slots_[slot].prev;
+    uint32_t next = slots_[slot].next;
+    if (prev != npos) {
+        slots_[prev].next = next;
+    } else {
+        head_ = next;
+    }
+    if (next != npos) {
+        slots_[next].prev = prev;
+    } else {
+        tail_ = prev;
+    }
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+void FlatLRUCache<Key, Value, Hash, Allocator>::touch(uint32_t slot) noexcept {
+    if (slot == head_) return;
+    unlink(slot);
+    link_front(slot);
+}
+
+// Backward-shift deletion: pulls later members of the probe run into the
+// hole, so the table never needs tombstones.
+template<typename Key, typename Value, typename Hash, typename Allocator>
+void FlatLRUCache<Key, Value, Hash, Allocator>::erase_bucket(uint32_t hole) noexcept {
+    for (uint32_t i = (hole + 1) & bucket_mask_; buckets_[i].slot != npos; i = (i + 1) & bucket_mask_) {
+        uint32_t home = buckets_[i].hash & bucket_mask_;
+        // Leave the entry alone if its home lies cyclically in (hole, i]
+        if (((i - home) & bucket_mask_) < ((i - hole) & bucket_mask_)) continue;
+        buckets_[hole] = buckets_[i];
+        hole = i;
+    }
+    buckets_[hole].slot = npos;
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+void FlatLRUCache<Key, Value, Hash, Allocator>::remove(uint32_t bucket) noexcept {
+    uint32_t slot = buckets_[bucket].slot;
+    erase_bucket(bucket);
+    unlink(slot);
+    entry(slot).~value_type();
+    slots_[slot].next = free_;
+    free_ = slot;
+    size_--;
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator>
+void FlatLRUCache<Key, Value, Hash, Allocator>::evict_oldest() {
+    if (tail_ == npos) return;
+    uint32_t bucket = find_bucket(entry(tail_).first, hash_of(entry(tail_).first));
+    remove(bucket);
+}
+
+#endif // FLAT_LRU_CACHE_HPP
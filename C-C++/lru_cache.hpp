@@ -2,22 +2,216 @@
 #ifndef LRU_CACHE_HPP
 #define LRU_CACHE_HPP
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <list>
 #include <unordered_map>
 #include <optional>
 #include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+// Eviction policies for LRUCache. A policy keeps the entries in one or more
+// segments, each a recency list with its most recent entry at the front,
+// moves entries between them on hits and inserts, and picks the entry to
+// evict when the cache is over capacity. Its hooks get the cache's
+// Segments view:
+//
+//   Policy(capacity, entries)  the cache's capacity and expected entry count
+//   segments                   number of segments (a constant)
+//   insert_segment()           segment new entries start in
+//   on_insert(segs, it)        a new entry was put at the front of insert_segment()
+//   on_hit(segs, it)           an entry was read, overwritten or promoted
+//   victim(segs)               entry to evict; may rearrange the segments first
+//
+// victim is called until the total weight fits the capacity again. Sizes and
+// capacities are weights, i.e. entry counts with the default UnitWeigher;
+// per-entry state such as a frequency sketch is sized by entries instead.
+// Segment 0 is the most protected one; for_each, peek_newest and peek_oldest
+// walk the segments in order.
+
+// Plain LRU: hits move to the front, the back is evicted.
+template<typename Key, typename Hash>
+class LRUPolicy {
+public:
+    static constexpr unsigned segments = 1;
+
+    LRUPolicy(std::size_t capacity, std::size_t entries) noexcept;
+
+    unsigned insert_segment() const noexcept;
+
+    template<typename Segments>
+    void on_insert(Segments& segs, typename Segments::iterator it) noexcept;
+
+    template<typename Segments>
+    void on_hit(Segments& segs, typename Segments::iterator it) noexcept;
+
+    template<typename Segments>
+    typename Segments::iterator victim(Segments& segs) noexcept;
+};
+
+// Segmented LRU: new entries go on probation and are evicted from there; an
+// entry hit on probation moves to the protected segment (80% of the
+// capacity), whose overflow is demoted back to probation. A one-off scan
+// only churns the probation segment.
+template<typename Key, typename Hash>
+class SegmentedLRUPolicy {
+public:
+    static constexpr unsigned segments = 2;
+    static constexpr unsigned protected_segment = 0;
+    static constexpr unsigned probation_segment = 1;
+
+    SegmentedLRUPolicy(std::size_t capacity, std::size_t entries) noexcept;
+
+    unsigned insert_segment() const noexcept;
+
+    template<typename Segments>
+    void on_insert(Segments& segs, typename Segments::iterator it) noexcept;
+
+    template<typename Segments>
+    void on_hit(Segments& segs, typename Segments::iterator it) noexcept;
+
+    template<typename Segments>
+    typename Segments::iterator victim(Segments& segs) noexcept;
+
+private:
+    std::size_t protected_capacity_;
+};
+
+// Count-min sketch of 4-bit saturating counters (four rows, sixteen counters
+// packed per word) estimating how often each key was seen recently, with a
+// row width of about one counter per expected entry. After 10 * entries
+// increments every counter is halved, so old popularity fades.
+template<typename Key, typename Hash>
+class FrequencySketch {
+public:
+    explicit FrequencySketch(std::size_t entries);
+
+    void increment(const Key& key);
+
+    // Estimated recent accesses of key, 0..15
+    unsigned frequency(const Key& key) const;
+
+private:
+    static constexpr unsigned rows = 4;
+    static constexpr unsigned max_count = 15;
+    static constexpr unsigned counters_per_word = 16;
+
+    uint64_t hash_of(const Key& key) const;
+    std::size_t index(uint64_t hash, unsigned row) const noexcept;
+    unsigned counter(std::size_t i) const noexcept;
+    void age() noexcept;
+
+    Hash hash_;
+    std::vector<uint64_t> counters_;
+    std::size_t width_mask_;
+    std::size_t additions_ = 0;
+    std::size_t sample_size_;
+};
+
+// W-TinyLFU: new entries go through a small LRU window (1% of the capacity).
+// An entry leaving the window only displaces the main space's eviction
+// candidate if the FrequencySketch has seen it more often; the main space is
+// a segmented LRU as above. The sketch counts each put of a new key and each
+// hit once; a get() that misses is left to the put() that follows it.
+template<typename Key, typename Hash>
+class WTinyLFUPolicy {
+public:
+    static constexpr unsigned segments = 3;
+    static constexpr unsigned protected_segment = 0;
+    static constexpr unsigned window_segment = 1;
+    static constexpr unsigned probation_segment = 2;
+
+    WTinyLFUPolicy(std::size_t capacity, std::size_t entries);
+
+    unsigned insert_segment() const noexcept;
+
+    template<typename Segments>
+    void on_insert(Segments& segs, typename Segments::iterator it);
+
+    template<typename Segments>
+    void on_hit(Segments& segs, typename Segments::iterator it);
+
+    template<typename Segments>
+    typename Segments::iterator victim(Segments& segs);
+
+private:
+    std::size_t capacity_;
+    std::size_t window_capacity_;
+    std::size_t protected_capacity_;
+    FrequencySketch<Key, Hash> sketch_;
+};
+
+// Weighs every entry as 1, so LRUCache's capacity counts entries
+struct UnitWeigher {
+    template<typename Key, typename Value>
+    std::size_t operator()(const Key&, const Value&) const noexcept { return 1; }
+};
 
-template<typename Key, typename Value, typename Hash = std::hash<Key>>
+template<typename Key, typename Value, typename Hash = std::hash<Key>,
+         typename Allocator = std::allocator<std::pair<const Key, Value>>,
+         template<typename, typename> class Policy = LRUPolicy,
+         typename Weigher = UnitWeigher>
 class LRUCache {
+    struct Node;
+    using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+    using ListType = std::list<Node, NodeAllocator>;
+    using ListIterator = typename ListType::iterator;
+
 public:
     using key_type = Key;
     using mapped_type = Value;
     using value_type = std::pair<const Key, Value>;
     using size_type = std::size_t;
+    using allocator_type = Allocator;
+    using policy_type = Policy<Key, Hash>;
+    using Clock = std::chrono::steady_clock;
+
+    // What the policy hooks see of the cache
+    class Segments {
+    public:
+        using iterator = ListIterator;
+
+        // Weight of the entries in segment / in the cache
+        size_type size(unsigned segment) const noexcept;
+        size_type total() const noexcept;
+
+        // Number of entries in segment
+        size_type count(unsigned segment) const noexcept;
+
+        iterator oldest(unsigned segment) noexcept;
+        unsigned segment_of(iterator it) const noexcept;
+        const Key& key_of(iterator it) const noexcept;
+
+        // Makes it the newest entry of segment
+        void move_to_front(iterator it, unsigned segment) noexcept;
+
+    private:
+        friend class LRUCache;
+        explicit Segments(LRUCache& cache) noexcept : cache_(cache) {}
+
+        LRUCache& cache_;
+    };
 
     // TODO: Document this constructor
     explicit LRUCache(size_type capacity);
 
+    // Both the recency list and the lookup table allocate their nodes from
+    // (rebound copies of) alloc, e.g. a PoolAllocator.
+    LRUCache(size_type capacity, const Allocator& alloc);
+
+    // capacity is in the units weigher(key, value) returns, e.g. bytes; puts
+    // evict until the total weight fits again. An entry heavier than the
+    // whole capacity is not stored: its put only removes the key's old entry.
+    // expected_entries, roughly how many entries fit, sizes the policy's
+    // per-entry state (W-TinyLFU's sketch).
+    LRUCache(size_type capacity, const Weigher& weigher, size_type expected_entries,
+             const Allocator& alloc = Allocator());
+
     // TODO: Document this function
     std::optional<Value> get(const Key& key);
 
@@ -27,12 +221,31 @@ public:
     // TODO: Document this function
     void put(const Key& key, Value&& value);
 
+    // Like put, but the entry expires ttl from now: lookups stop finding it
+    // and it is reclaimed by get, later puts or evict_expired(). A plain put
+    // of the key drops the TTL again. Throws std::invalid_argument if
+    // ttl <= 0.
+    void put(const Key& key, const Value& value, Clock::duration ttl);
+    void put(const Key& key, Value&& value, Clock::duration ttl);
+
+    // Returns the entry for key, or nullptr, without making it the most
+    // recently used. The pointer stays valid until the entry is removed.
+    const value_type* find(const Key& key) const;
+
+    // Counts as a hit on key (makes it the most recently used entry under
+    // LRUPolicy). Returns false if it isn't cached.
+    bool promote(const Key& key);
+
     // TODO: Document this function
     bool contains(const Key& key) const;
 
     // TODO: Document this function
     bool erase(const Key& key);
 
+    // Removes every expired entry and returns how many there were. Only
+    // expired entries are visited. Until then size() still counts them.
+    size_type evict_expired();
+
     // TODO: Document this function
     void clear();
 
@@ -42,6 +255,9 @@ public:
     // TODO: Document this function
     size_type capacity() const noexcept;
 
+    // Total weight of the entries (size() with UnitWeigher)
+    size_type weight() const noexcept;
+
     // TODO: Document this function
     bool empty() const noexcept;
 
@@ -56,137 +272,668 @@ public:
     std::optional<std::pair<Key, Value>> peek_newest() const;
 
 private:
-    using ListType = std::list<value_type>;
-    using ListIterator = typename ListType::iterator;
-    using MapType = std::unordered_map<Key, ListIterator, Hash>;
-
-    void evict_oldest();
-    void touch(ListIterator it);
+    // heap_index of entries without a TTL
+    static constexpr uint32_t no_deadline = UINT32_MAX;
+
+    // Expired entries reclaimed by a put that has room
+    static constexpr size_type expiry_batch = 2;
+
+    // Nodes only store a weight if it can differ from 1, so nodes of a cache
+    // counting entries stay small.
+    struct StoredWeight {
+        size_type weight;
+    };
+    struct UnitWeight {
+        static constexpr size_type weight = 1;
+    };
+    static constexpr bool unit_weights = std::is_same<Weigher, UnitWeigher>::value;
+
+    struct Node : std::conditional_t<unit_weights, UnitWeight, StoredWeight> {
+        template<typename V>
+        Node(const Key& key, V&& value, unsigned seg, size_type w) : kv(key, std::forward<V>(value)), segment(seg) {
+            set_weight(w);
+        }
+
+        void set_weight(size_type w) noexcept {
+            if constexpr (!unit_weights) this->weight = w;
+        }
+
+        value_type kv;
+        uint32_t segment;
+        uint32_t heap_index = no_deadline;   // Position in expiry_
+    };
+
+    struct Expiry {
+        Clock::time_point deadline;
+        ListIterator node;
+    };
+
+    using MapAllocator = typename std::allocator_traits<Allocator>::template
+        rebind_alloc<std::pair<const Key, ListIterator>>;
+    using MapType = std::unordered_map<Key, ListIterator, Hash, std::equal_to<Key>, MapAllocator>;
+    using HeapAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Expiry>;
+
+    template<typename V>
+    void put_impl(const Key& key, V&& value, const Clock::time_point* deadline);
+
+    bool expired(const Node& node) const;
+
+    // Track the weight per segment; with unit weights the counts say it all
+    void add_weight(unsigned segment, size_type weight) noexcept;
+    void sub_weight(unsigned segment, size_type weight) noexcept;
+    void remove(ListIterator it);
+    size_type reclaim_expired(size_type limit);
+
+    // Binary min-heap of the entries with a TTL, by deadline
+    void set_deadline(ListIterator it, const Clock::time_point* deadline) noexcept;
+    void heap_erase(ListIterator it) noexcept;
+    void sift_up(size_type index) noexcept;
+    void sift_down(size_type index) noexcept;
+    void heap_place(size_type index, const Expiry& entry) noexcept;
 
     size_type capacity_;
-    ListType items_;      // Front = newest, Back = oldest
+    size_type weight_ = 0;
+    std::vector<ListType> items_;   // One per segment; Front = newest, Back = oldest
+    std::vector<size_type> segment_weights_;
     MapType lookup_;
+    std::vector<Expiry, HeapAllocator> expiry_;
+    Weigher weigher_;
+    policy_type policy_;
 };
 
 // Implementation
-template<typename Key, typename Value, typename Hash>
-LRUCache<Key, Value, Hash>::LRUCache(size_type capacity) : capacity_(capacity) {
+template<typename Key, typename Hash>
+LRUPolicy<Key, Hash>::LRUPolicy(std::size_t, std::size_t) noexcept {}
+
+template<typename Key, typename Hash>
+unsigned LRUPolicy<Key, Hash>::insert_segment() const noexcept {
+    return 0;
+}
+
+template<typename Key, typename Hash>
+template<typename Segments>
+void LRUPolicy<Key, Hash>::on_insert(Segments&, typename Segments::iterator) noexcept {}
+
+template<typename Key, typename Hash>
+template<typename Segments>
+void LRUPolicy<Key, Hash>::on_hit(Segments& segs, typename Segments::iterator it) noexcept {
+    segs.move_to_front(it, 0);
+}
+
+template<typename Key, typename Hash>
+template<typename Segments>
+typename Segments::iterator LRUPolicy<Key, Hash>::victim(Segments& segs) noexcept {
+    return segs.oldest(0);
+}
+
+template<typename Key, typename Hash>
+SegmentedLRUPolicy<Key, Hash>::SegmentedLRUPolicy(std::size_t capacity, std::size_t) noexcept
+    : protected_capacity_(capacity - capacity / 5) {}
+
+template<typename Key, typename Hash>
+unsigned SegmentedLRUPolicy<Key, Hash>::insert_segment() const noexcept {
+    return probation_segment;
+}
+
+template<typename Key, typename Hash>
+template<typename Segments>
+void SegmentedLRUPolicy<Key, Hash>::on_insert(Segments&, typename Segments::iterator) noexcept {}
+
+template<typename Key, typename Hash>
+template<typename Segments>
+void SegmentedLRUPolicy<Key, Hash>::on_hit(Segments& segs, typename Segments::iterator it) noexcept {
+    segs.move_to_front(it, protected_segment);
+    while (segs.size(protected_segment) > protected_capacity_) {
+        segs.move_to_front(segs.oldest(protected_segment), probation_segment);
+    }
+}
+
+template<typename Key, typename Hash>
+template<typename Segments>
+typename Segments::iterator SegmentedLRUPolicy<Key, Hash>::victim(Segments& segs) noexcept {
+    // Evicting the entry just put on probation would lock out newcomers
+    // for good once probation is otherwise empty.
+    if (segs.count(probation_segment) > 1 || segs.count(protected_segment) == 0) {
+        return segs.oldest(probation_segment);
+    }
+    return segs.oldest(protected_segment);
+}
+
+template<typename Key, typename Hash>
+FrequencySketch<Key, Hash>::FrequencySketch(std::size_t entries) : sample_size_(10 * entries) {
+    std::size_t width = 16;
+    while (width < entries) width <<= 1;
+    width_mask_ = width - 1;
+    counters_.assign(rows * width / counters_per_word, 0);
+}
+
+// Mixes the hash first: std::hash is often the identity
+template<typename Key, typename Hash>
+uint64_t FrequencySketch<Key, Hash>::hash_of(const Key& key) const {
+    uint64_t h = static_cast<uint64_t>(hash_(key));
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Row r has its own stretch of counters_, indexed by h1 + r * h2
+template<typename Key, typename Hash>
+std::size_t FrequencySketch<Key, Hash>::index(uint64_t hash, unsigned row) const noexcept {
+    uint64_t h1 = hash & 0xffffffffu;
+    uint64_t h2 = (hash >> 32) | 1;
+    return row * (width_mask_ + 1) + static_cast<std::size_t>((h1 + row * h2) & width_mask_);
+}
+
+template<typename Key, typename Hash>
+void FrequencySketch<Key, Hash>::increment(const Key& key) {
+    uint64_t hash = hash_of(key);
+    for (unsigned row = 0; row < rows; row++) {
+        std::size_t i = index(hash, row);
+        if (counter(i) < max_count) counters_[i / counters_per_word] += uint64_t(1) << (i % counters_per_word * 4);
+    }
+    if (++additions_ >= sample_size_) age();
+}
+
+template<typename Key, typename Hash>
+unsigned FrequencySketch<Key, Hash>::frequency(const Key& key) const {
+    uint64_t hash = hash_of(key);
+    unsigned count = max_count;
+    for (unsigned row = 0; row < rows; row++) {
+        count = std::min(count, counter(index(hash, row)));
+    }
+    return count;
+}
+
+template<typename Key, typename Hash>
+unsigned FrequencySketch<Key, Hash>::counter(std::size_t i) const noexcept {
+    return static_cast<unsigned>(counters_[i / counters_per_word] >> (i % counters_per_word * 4)) & 0xf;
+}
+
+// Halves all sixteen counters of a word at once; the mask drops the bit
+// each one would shift into its lower neighbour
+template<typename Key, typename Hash>
+void FrequencySketch<Key, Hash>::age() noexcept {
+    for (uint64_t& word : counters_) word = (word >> 1) & 0x7777777777777777ULL;
+    additions_ /= 2;
+}
+
+template<typename Key, typename Hash>
+WTinyLFUPolicy<Key, Hash>::WTinyLFUPolicy(std::size_t capacity, std::size_t entries)
+    : capacity_(capacity), window_capacity_(std::max<std::size_t>(1, capacity / 100)),
+      protected_capacity_((capacity - window_capacity_) - (capacity - window_capacity_) / 5),
+      sketch_(entries) {}
+
+template<typename Key, typename Hash>
+unsigned WTinyLFUPolicy<Key, Hash>::insert_segment() const noexcept {
+    return window_segment;
+}
+
+// Until the cache is full, window overflow moves straight to probation
+template<typename Key, typename Hash>
+template<typename Segments>
+void WTinyLFUPolicy<Key, Hash>::on_insert(Segments& segs, typename Segments::iterator it) {
+    sketch_.increment(segs.key_of(it));
+    while (segs.size(window_segment) > window_capacity_ && segs.total() <= capacity_) {
+        segs.move_to_front(segs.oldest(window_segment), probation_segment);
+    }
+}
+
+template<typename Key, typename Hash>
+template<typename Segments>
+void WTinyLFUPolicy<Key, Hash>::on_hit(Segments& segs, typename Segments::iterator it) {
+    sketch_.increment(segs.key_of(it));
+    if (segs.segment_of(it) == window_segment) {
+        segs.move_to_front(it, window_segment);
+        return;
+    }
+    segs.move_to_front(it, protected_segment);
+    while (segs.size(protected_segment) > protected_capacity_) {
+        segs.move_to_front(segs.oldest(protected_segment), probation_segment);
+    }
+}
+
+// The window's oldest entry and probation's oldest compete for the main
+// space; the one the sketch has seen less often is evicted.
+template<typename Key, typename Hash>
+template<typename Segments>
+typename Segments::iterator WTinyLFUPolicy<Key, Hash>::victim(Segments& segs) {
+    if (segs.size(window_segment) > window_capacity_) {
+        auto candidate = segs.oldest(window_segment);
+        if (segs.count(probation_segment) == 0) {
+            if (segs.count(protected_segment) == 0) return candidate;
+            segs.move_to_front(segs.oldest(protected_segment), probation_segment);
+        }
+
+        auto incumbent = segs.oldest(probation_segment);
+        if (sketch_.frequency(segs.key_of(candidate)) > sketch_.frequency(segs.key_of(incumbent))) {
+            segs.move_to_front(candidate, probation_segment);
+            return incumbent;
+        }
+        return candidate;
+    }
+
+    if (segs.count(probation_segment) > 0) return segs.oldest(probation_segment);
+    if (segs.count(protected_segment) > 0) return segs.oldest(protected_segment);
+    return segs.oldest(window_segment);
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+typename LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::size_type
+LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::Segments::size(unsigned segment) const noexcept {
+    if constexpr (unit_weights) return cache_.items_[segment].size();
+    return cache_.segment_weights_[segment];
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+typename LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::size_type
+LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::Segments::total() const noexcept {
+    return cache_.weight();
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+typename LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::size_type
+LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::Segments::count(unsigned segment) const noexcept {
+    return cache_.items_[segment].size();
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+typename LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::Segments::iterator
+LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::Segments::oldest(unsigned segment) noexcept {
+    return std::prev(cache_.items_[segment].end());
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+unsigned LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::Segments::segment_of(iterator it) const noexcept {
+    return it->segment;
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+const Key& LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::Segments::key_of(iterator it) const noexcept {
+    return it->kv.first;
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+void LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::Segments::move_to_front(iterator it, unsigned segment) noexcept {
+    ListType& to = cache_.items_[segment];
+    to.splice(to.begin(), cache_.items_[it->segment], it);
+    cache_.sub_weight(it->segment, it->weight);
+    cache_.add_weight(segment, it->weight);
+    it->segment = segment;
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::LRUCache(size_type capacity)
+    : LRUCache(capacity, Weigher(), capacity, Allocator()) {}
+
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::LRUCache(size_type capacity, const Allocator& alloc)
+    : LRUCache(capacity, Weigher(), capacity, alloc) {}
+
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::LRUCache(size_type capacity, const Weigher& weigher,
+                                                                 size_type expected_entries, const Allocator& alloc)
+    : capacity_(capacity), segment_weights_(policy_type::segments, 0),
+      lookup_(0, Hash(), std::equal_to<Key>(), MapAllocator(alloc)), expiry_(HeapAllocator(alloc)),
+      weigher_(weigher), policy_(capacity, expected_entries) {
     if (capacity == 0) {
         throw std::invalid_argument("LRUCache capacity must be > 0");
     }
+    if (expected_entries == 0) {
+        throw std::invalid_argument("LRUCache expected_entries must be > 0");
+    }
+    items_.reserve(policy_type::segments);
+    for (unsigned i = 0; i < policy_type::segments; i++) {
+        items_.emplace_back(NodeAllocator(alloc));
+    }
 }
 
-template<typename Key, typename Value, typename Hash>
-std::optional<Value> LRUCache<Key, Value, Hash>::get(const Key& key) {
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+std::optional<Value> LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::get(const Key& key) {
     auto it = lookup_.find(key);
     if (it == lookup_.end()) {
         return std::nullopt;
     }
-    touch(it->second);
-    return it->second->second;
+    if (expired(*it->second)) {
+        remove(it->second);
+        return std::nullopt;
+    }
+    Segments segs(*this);
+    policy_.on_hit(segs, it->second);
+    return it->second->kv.second;
 }
 
-template<typename Key, typename Value, typename Hash>
-void LRUCache<Key, Value, Hash>::put(const Key& key, const Value& value) {
-    auto it = lookup_.find(key);
-    if (it != lookup_.end()) {
-        it->second->second = value;
-        touch(it->second);
-        return;
-    }
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+void LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::put(const Key& key, const Value& value) {
+    put_impl(key, value, nullptr);
+}
 
-    if (items_.size() >= capacity_) {
-        evict_oldest();
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+void LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::put(const Key& key, Value&& value) {
+    put_impl(key, std::move(value), nullptr);
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+void LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::put(const Key& key, const Value& value, Clock::duration ttl) {
+    if (ttl <= Clock::duration::zero()) {
+        throw std::invalid_argument("LRUCache ttl must be > 0");
     }
+    Clock::time_point deadline = Clock::now() + ttl;
+    put_impl(key, value, &deadline);
+}
 
-    items_.emplace_front(key, value);
-    lookup_[key] = items_.begin();
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+void LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::put(const Key& key, Value&& value, Clock::duration ttl) {
+    if (ttl <= Clock::duration::zero()) {
+        throw std::invalid_argument("LRUCache ttl must be > 0");
+    }
+    Clock::time_point deadline = Clock::now() + ttl;
+    put_impl(key, std::move(value), &deadline);
 }
 
-template<typename Key, typename Value, typename Hash>
-void LRUCache<Key, Value, Hash>::put(const Key& key, Value&& value) {
+// The entry is linked in before the policy picks victims, so an admission
+// policy can turn the new entry itself away. Expired entries go first: a put
+// with room to spare reclaims a few, one over capacity all of them. An entry
+// that cannot fit even alone is turned away up front, or evicting for it
+// would empty the cache first.
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+template<typename V>
+void LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::put_impl(const Key& key, V&& value, const Clock::time_point* deadline) {
+    size_type entry_weight = weigher_(key, static_cast<const Value&>(value));
+    if (entry_weight > capacity_) {
+        erase(key);
+        return;
+    }
+    if (deadline && expiry_.size() == expiry_.capacity()) {
+        expiry_.reserve(2 * expiry_.size() + 1);
+    }
+
+    Segments segs(*this);
     auto it = lookup_.find(key);
     if (it != lookup_.end()) {
-        it->second->second = std::move(value);
-        touch(it->second);
-        return;
+        ListIterator node = it->second;
+        node->kv.second = std::forward<V>(value);
+        sub_weight(node->segment, node->weight);
+        add_weight(node->segment, entry_weight);
+        node->set_weight(entry_weight);
+        set_deadline(node, deadline);
+        policy_.on_hit(segs, node);
+    } else {
+        unsigned segment = policy_.insert_segment();
+        ListType& list = items_[segment];
+        list.emplace_front(key, std::forward<V>(value), segment, entry_weight);
+        try {
+            lookup_.emplace(key, list.begin());
+        } catch (...) {
+            list.pop_front();
+            throw;
+        }
+        add_weight(segment, entry_weight);
+        set_deadline(list.begin(), deadline);
+        policy_.on_insert(segs, list.begin());
     }
 
-    if (items_.size() >= capacity_) {
-        evict_oldest();
+    reclaim_expired(weight() > capacity_ ? expiry_.size() : expiry_batch);
+    while (weight() > capacity_) {
+        remove(policy_.victim(segs));
     }
+}
 
-    items_.emplace_front(key, std::move(value));
-    lookup_[key] = items_.begin();
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+const typename LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::value_type*
+LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::find(const Key& key) const {
+    auto it = lookup_.find(key);
+    if (it == lookup_.end() || expired(*it->second)) {
+        return nullptr;
+    }
+    return &it->second->kv;
+}
+
+// Leaves an expired entry in place: ConcurrentLRUCache replays buffered
+// hits through here and may hold further pointers to the same entry.
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+bool LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::promote(const Key& key) {
+    auto it = lookup_.find(key);
+    if (it == lookup_.end() || expired(*it->second)) {
+        return false;
+    }
+    Segments segs(*this);
+    policy_.on_hit(segs, it->second);
+    return true;
 }
 
-template<typename Key, typename Value, typename Hash>
-bool LRUCache<Key, Value, Hash>::contains(const Key& key) const {
-    return lookup_.find(key) != lookup_.end();
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+bool LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::contains(const Key& key) const {
+    auto it = lookup_.find(key);
+    return it != lookup_.end() && !expired(*it->second);
 }
 
-template<typename Key, typename Value, typename Hash>
-bool LRUCache<Key, Value, Hash>::erase(const Key& key) {
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+bool LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::erase(const Key& key) {
     auto it = lookup_.find(key);
     if (it == lookup_.end()) {
         return false;
     }
-    items_.erase(it->second);
-    lookup_.erase(it);
+    remove(it->second);
     return true;
 }
 
-template<typename Key, typename Value, typename Hash>
-void LRUCache<Key, Value, Hash>::clear() {
-    items_.clear();
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+typename LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::size_type LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::evict_expired() {
+    return reclaim_expired(expiry_.size());
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+void LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::clear() {
+    for (auto& list : items_) list.clear();
+    std::fill(segment_weights_.begin(), segment_weights_.end(), 0);
+    weight_ = 0;
     lookup_.clear();
+    expiry_.clear();
 }
 
-template<typename Key, typename Value, typename Hash>
-typename LRUCache<Key, Value, Hash>::size_type LRUCache<Key, Value, Hash>::size() const noexcept {
-    return items_.size();
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+typename LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::size_type
+LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::size() const noexcept {
+    return lookup_.size();
 }
 
-template<typename Key, typename Value, typename Hash>
-typename LRUCache<Key, Value, Hash>::size_type LRUCache<Key, Value, Hash>::capacity() const noexcept {
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+typename LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::size_type
+LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::capacity() const noexcept {
     return capacity_;
 }
 
-template<typename Key, typename Value, typename Hash>
-bool LRUCache<Key, Value, Hash>::empty() const noexcept {
-    return items_.empty();
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+typename LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::size_type
+LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::weight() const noexcept {
+    if constexpr (unit_weights) return lookup_.size();
+    return weight_;
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+bool LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::empty() const noexcept {
+    return lookup_.empty();
 }
 
-template<typename Key, typename Value, typename Hash>
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
 template<typename Func>
-void LRUCache<Key, Value, Hash>::for_each(Func&& fn) const {
-    for (const auto& item : items_) {
-        fn(item.first, item.second);
+void LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::for_each(Func&& fn) const {
+    for (const auto& list : items_) {
+        for (const auto& item : list) {
+            if (!expired(item)) fn(item.kv.first, item.kv.second);
+        }
+    }
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+std::optional<std::pair<Key, Value>> LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::peek_oldest() const {
+    for (auto list = items_.rbegin(); list != items_.rend(); ++list) {
+        for (auto item = list->rbegin(); item != list->rend(); ++item) {
+            if (!expired(*item)) return item->kv;
+        }
+    }
+    return std::nullopt;
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+std::optional<std::pair<Key, Value>> LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::peek_newest() const {
+    for (const auto& list : items_) {
+        for (const auto& item : list) {
+            if (!expired(item)) return item.kv;
+        }
+    }
+    return std::nullopt;
+}
+
+// Only entries with a TTL read the clock
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+bool LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::expired(const Node& node) const {
+    return node.heap_index != no_deadline && expiry_[node.heap_index].deadline <= Clock::now();
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+void LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::remove(ListIterator it) {
+    if (it->heap_index != no_deadline) heap_erase(it);
+    sub_weight(it->segment, it->weight);
+    lookup_.erase(it->kv.first);
+    items_[it->segment].erase(it);
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+void LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::add_weight(unsigned segment, size_type weight) noexcept {
+    if constexpr (!unit_weights) {
+        weight_ += weight;
+        segment_weights_[segment] += weight;
+    }
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+void LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::sub_weight(unsigned segment, size_type weight) noexcept {
+    if constexpr (!unit_weights) {
+        weight_ -= weight;
+        segment_weights_[segment] -= weight;
     }
 }
 
-template<typename Key, typename Value, typename Hash>
-std::optional<std::pair<Key, Value>> LRUCache<Key, Value, Hash>::peek_oldest() const {
-    if (items_.empty()) return std::nullopt;
-    return items_.back();
+// Pops expired entries off the top of the heap, so it never looks at a
+// live one beyond the first.
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+typename LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::size_type LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::reclaim_expired(size_type limit) {
+    if (expiry_.empty() || limit == 0) return 0;
+
+    Clock::time_point now = Clock::now();
+    size_type removed = 0;
+    while (removed < limit && !expiry_.empty() && expiry_.front().deadline <= now) {
+        remove(expiry_.front().node);
+        removed++;
+    }
+    return removed;
 }
 
-template<typename Key, typename Value, typename Hash>
-std::optional<std::pair<Key, Value>> LRUCache<Key, Value, Hash>::peek_newest() const {
-    if (items_.empty()) return std::nullopt;
-    return items_.front();
+// Requires room in expiry_ for a new entry
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+void LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::set_deadline(ListIterator it, const Clock::time_point* deadline) noexcept {
+    if (!deadline) {
+        if (it->heap_index != no_deadline) heap_erase(it);
+        return;
+    }
+
+    if (it->heap_index == no_deadline) {
+        it->heap_index = static_cast<uint32_t>(expiry_.size());
+        expiry_.push_back(Expiry{*deadline, it});
+    } else {
+        expiry_[it->heap_index].deadline = *deadline;
+    }
+    sift_up(it->heap_index);
+    sift_down(it->heap_index);
 }
 
-template<typename Key, typename Value, typename Hash>
-void LRUCache<Key, Value, Hash>::evict_oldest() {
-    if (items_.empty()) return;
-    lookup_.erase(items_.back().first);
-    items_.pop_back();
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+void LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::heap_erase(ListIterator it) noexcept {
+    size_type index = it->heap_index;
+    Expiry last = expiry_.back();
+    expiry_.pop_back();
+    it->heap_index = no_deadline;
+    if (index == expiry_.size()) return;
+
+    heap_place(index, last);
+    sift_up(index);
+    sift_down(last.node->heap_index);
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+void LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::sift_up(size_type index) noexcept {
+    Expiry entry = expiry_[index];
+    while (index > 0) {
+        size_type parent = (index - 1) / 2;
+        if (!(entry.deadline < expiry_[parent].deadline)) break;
+        heap_place(index, expiry_[parent]);
+        index = parent;
+    }
+    heap_place(index, entry);
+}
+
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+void LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::sift_down(size_type index) noexcept {
+    Expiry entry = expiry_[index];
+    size_type count = expiry_.size();
+    for (;;) {
+        size_type child = 2 * index + 1;
+        if (child >= count) break;
+        if (child + 1 < count && expiry_[child + 1].deadline < expiry_[child].deadline) child++;
+        if (!(expiry_[child].deadline < entry.deadline)) break;
+        heap_place(index, expiry_[child]);
+        index = child;
+    }
+    heap_place(index, entry);
 }
 
-template<typename Key, typename Value, typename Hash>
-void LRUCache<Key, Value, Hash>::touch(ListIterator it) {
-    items_.splice(items_.begin(), items_, it);
+template<typename Key, typename Value, typename Hash, typename Allocator, template<typename, typename> class Policy,
+         typename Weigher>
+void LRUCache<Key, Value, Hash, Allocator, Policy, Weigher>::heap_place(size_type index, const Expiry& entry) noexcept {
+    expiry_[index] = entry;
+    entry.node->heap_index = static_cast<uint32_t>(index);
 }
 
 #endif // LRU_CACHE_HPP
@@ -0,0 +1,66 @@
+// lru_trace_replay.cpp
+//
+// Replays a key trace through LRUCache under each eviction policy and
+// reports the hit ratios. The trace is whitespace-separated keys, e.g. one
+// per line; every access is a get() followed by a put() on a miss.
+//
+//   c++ -std=c++17 -O2 lru_trace_replay.cpp -o lru_trace_replay
+//   ./lru_trace_replay capacity [trace_file]    (reads stdin without a file)
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "lru_cache.hpp"
+
+template<template<typename, typename> class Policy>
+static void replay(const char* name, std::size_t capacity, const std::vector<std::string>& trace) {
+    LRUCache<std::string, char, std::hash<std::string>, std::allocator<std::pair<const std::string, char>>,
+             Policy> cache(capacity);
+    std::size_t hits = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (const std::string& key : trace) {
+        if (cache.get(key)) {
+            hits++;
+        } else {
+            cache.put(key, 0);
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::printf("%-10s hits %zu / %zu (%.2f%%) in %.3f s\n", name, hits, trace.size(),
+                trace.empty() ? 0.0 : 100.0 * static_cast<double>(hits) / static_cast<double>(trace.size()),
+                elapsed.count());
+}
+
+int main(int argc, char** argv) {
+    std::size_t capacity = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 0;
+    if (argc < 2 || argc > 3 || capacity == 0) {
+        std::fprintf(stderr, "usage: %s capacity [trace_file]\n", argv[0]);
+        return 2;
+    }
+
+    std::ifstream file;
+    if (argc > 2) {
+        file.open(argv[2]);
+        if (!file) {
+            std::fprintf(stderr, "cannot open %s\n", argv[2]);
+            return 2;
+        }
+    }
+    std::istream& in = argc > 2 ? file : std::cin;
+
+    std::vector<std::string> trace;
+    std::string key;
+    while (in >> key) trace.push_back(std::move(key));
+
+    std::printf("%zu accesses, capacity %zu\n", trace.size(), capacity);
+    replay<LRUPolicy>("LRU", capacity, trace);
+    replay<SegmentedLRUPolicy>("SLRU", capacity, trace);
+    replay<WTinyLFUPolicy>("W-TinyLFU", capacity, trace);
+    return 0;
+}
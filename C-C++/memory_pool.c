@@ -1,85 +1,997 @@
 // memory_pool.c
+#define _DEFAULT_SOURCE // MAP_ANONYMOUS, madvise
 #include "memory_pool.h"
 #include <stdlib.h>
 #include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#ifdef POOL_DEBUG
+#include <stdio.h>
+#endif
 
-struct MemoryPool {
+#ifndef POOL_MAGAZINE_SIZE
+#define POOL_MAGAZINE_SIZE 32   // Blocks moved between a thread cache and the depot at once
+#endif
+
+#ifndef POOL_MAX_THREADS
+#define POOL_MAX_THREADS 64     // Threads beyond this share one locked cache
+#endif
+
+#define POOL_CACHE_LINE 64
+#define POOL_HUGE_PAGE_SIZE ((size_t)2 << 20)
+#define POOL_SHARED_SLOT POOL_MAX_THREADS
+#define POOL_POISON_BYTE 0xDD
+
+// Per-thread block cache: two singly linked "magazines". `previous` is
+// always either empty or holds exactly POOL_MAGAZINE_SIZE blocks, so it can
+// be handed to the depot as a whole batch. Counts are only written by the
+// owning thread; they are atomic so pool_available and pool_stats can read
+// them.
+typedef struct {
+    _Alignas(POOL_CACHE_LINE) uint8_t* loaded;
+    uint8_t* previous;
+    atomic_size_t loaded_count;
+    atomic_size_t previous_count;
+    atomic_size_t allocs;
+    atomic_size_t frees;
+} PoolThreadCache;
+
+// The depot is a pair of Treiber stacks over a fixed array of batch
+// descriptors: `full` holds batches of exactly POOL_MAGAZINE_SIZE blocks,
+// `spare` holds recycled descriptors. Stack tops pack a 32-bit ABA tag with
+// a 1-based descriptor index (0 = empty), so a stalled thread can never pop
+// a descriptor that was recycled underneath it. Descriptors that have never
+// been used are handed out from `fresh`, so the array needs no setup pass.
+typedef struct {
+    uint8_t* batch;
+    _Atomic uint32_t next;
+} PoolBatchNode;
+
+typedef struct {
+    PoolBatchNode* nodes;
+    _Alignas(POOL_CACHE_LINE) _Atomic uint64_t full;
+    _Alignas(POOL_CACHE_LINE) _Atomic uint64_t spare;
+    _Atomic uint32_t fresh;
+    atomic_size_t batches;
+} PoolDepot;
+
+// A contiguous run of blocks. Growable pools chain several of these.
+// Blocks at index >= bump have never been handed out, so a new slab needs
+// no free-list threading and its pages are only touched on first use. The
+// per-slab free list and partial-list links are only used outside
+// concurrent mode (concurrent pools move blocks through the depot instead).
+typedef struct PoolSlab {
     uint8_t* memory;
-    uint8_t* free_list;
-    size_t block_size;
     size_t block_count;
+    size_t map_size;                // Non-zero when memory came from mmap
+    bool borrowed;                  // Caller-supplied memory; never freed here
+    atomic_size_t bump;
+    uint8_t* free_list;
+    size_t free_count;              // Free-list blocks + never-used blocks
+    struct PoolSlab* prev_partial;
+    struct PoolSlab* next_partial;
+#ifdef POOL_DEBUG
+    _Atomic uint64_t* live;         // One bit per block, set while allocated
+#endif
+} PoolSlab;
+
+// Slabs sorted by address for O(log n) pointer lookup. Published as a whole
+// so concurrent readers never see a half-updated table.
+typedef struct PoolSlabTable {
+    struct PoolSlabTable* retired_next;
+    size_t count;
+    PoolSlab* slabs[];
+} PoolSlabTable;
+
+struct MemoryPool {
+    _Atomic(PoolSlabTable*) table;
+    PoolSlab* base_slab;            // The slab from pool_create; never released
+    PoolSlab* partial;              // Slabs with at least one free block
+    size_t block_size;              // Stride between blocks, alignment included
+    size_t alignment;
+    atomic_size_t block_count;      // Current capacity across all slabs
     size_t free_count;
+    size_t empty_slabs;             // Fully free slabs currently kept
+    size_t initial_count;
+    size_t max_block_count;
+    unsigned flags;
+
+    // Statistics; the per-op counters live in the thread caches in concurrent mode
+    size_t total_allocs;
+    size_t total_frees;
+    atomic_size_t peak_in_use;
+    atomic_size_t failed_allocs;
+    atomic_size_t invalid_frees;
+    atomic_size_t checked_out;      // Concurrent: blocks outside the depot and bump regions
+
+    // POOL_FLAG_CONCURRENT only
+    PoolThreadCache* caches;        // POOL_MAX_THREADS slots + shared overflow slot
+    atomic_flag shared_lock;        // Guards caches[POOL_SHARED_SLOT]
+    pthread_mutex_t grow_lock;
+    _Atomic(PoolSlab*) carve_slab;  // Newest slab; its bump region feeds refills
+    PoolSlabTable* retired;         // Superseded tables, freed on destroy
+    MemoryPool* registry_next;
+    PoolDepot depot;
 };
 
+// Thread slot bookkeeping. A thread claims a slot index on its first
+// concurrent alloc/free; on exit its cached blocks are returned to every
+// live concurrent pool and the index is recycled.
+static pthread_once_t pool_tls_once = PTHREAD_ONCE_INIT;
+static pthread_key_t pool_tls_key;
+static pthread_mutex_t pool_registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static MemoryPool* pool_registry = NULL;
+static int pool_free_slots[POOL_MAX_THREADS];
+static size_t pool_free_slot_count = 0;
+static int pool_next_slot = 0;
+static _Thread_local int pool_thread_slot = -1;
+
+static void pool_stack_push(PoolBatchNode* nodes, _Atomic uint64_t* top, uint32_t index) {
+    uint64_t old = atomic_load_explicit(top, memory_order_relaxed);
+    uint64_t desired;
+    do {
+        atomic_store_explicit(&nodes[index - 1].next, (uint32_t)old, memory_order_relaxed);
+        desired = (((old >> 32) + 1) << 32) | index;
+    } while (!atomic_compare_exchange_weak_explicit(top, &old, desired,
+                                                    memory_order_release,
+                                                    memory_order_relaxed));
+}
+
+static uint32_t pool_stack_pop(PoolBatchNode* nodes, _Atomic uint64_t* top) {
+    uint64_t old = atomic_load_explicit(top, memory_order_acquire);
+    for (;;) {
+        uint32_t index = (uint32_t)old;
+        if (index == 0) return 0;
+        uint32_t next = atomic_load_explicit(&nodes[index - 1].next, memory_order_relaxed);
+        uint64_t desired = (((old >> 32) + 1) << 32) | next;
+        if (atomic_compare_exchange_weak_explicit(top, &old, desired,
+                                                  memory_order_acquire,
+                                                  memory_order_acquire)) {
+            return index;
+        }
+    }
+}
+
+// Each thread holds at most one descriptor between the two stacks, so
+// enough descriptors for every full batch plus one per slot never run out.
+static void pool_depot_push(PoolDepot* depot, uint8_t* batch) {
+    uint32_t index = pool_stack_pop(depot->nodes, &depot->spare);
+    if (index == 0) {
+        index = atomic_fetch_add_explicit(&depot->fresh, 1, memory_order_relaxed) + 1;
+    }
+    depot->nodes[index - 1].batch = batch;
+    pool_stack_push(depot->nodes, &depot->full, index);
+    atomic_fetch_add_explicit(&depot->batches, 1, memory_order_relaxed);
+}
+
+static uint8_t* pool_depot_pop(PoolDepot* depot) {
+    uint32_t index = pool_stack_pop(depot->nodes, &depot->full);
+    if (index == 0) return NULL;
+    atomic_fetch_sub_explicit(&depot->batches, 1, memory_order_relaxed);
+    uint8_t* batch = depot->nodes[index - 1].batch;
+    pool_stack_push(depot->nodes, &depot->spare, index);
+    return batch;
+}
+
+static size_t pool_depot_blocks(const PoolDepot* depot) {
+    return atomic_load_explicit(&depot->batches, memory_order_relaxed) * POOL_MAGAZINE_SIZE;
+}
+
+static void pool_shared_lock(MemoryPool* pool) {
+    while (atomic_flag_test_and_set_explicit(&pool->shared_lock, memory_order_acquire)) {
+        // spin
+    }
+}
+
+static void pool_shared_unlock(MemoryPool* pool) {
+    atomic_flag_clear_explicit(&pool->shared_lock, memory_order_release);
+}
+
+// Increment for counters with a single writer: a plain load and store, no
+// read-modify-write.
+static void pool_owner_add(atomic_size_t* counter, size_t delta) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + delta,
+                          memory_order_relaxed);
+}
+
+static void pool_raise_peak(MemoryPool* pool, size_t in_use) {
+    size_t peak = atomic_load_explicit(&pool->peak_in_use, memory_order_relaxed);
+    while (in_use > peak &&
+           !atomic_compare_exchange_weak_explicit(&pool->peak_in_use, &peak, in_use,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+    }
+}
+
+// Concurrent pools can't see how many cached blocks are really in use, so
+// the peak counts every block that has left the depot or bump regions.
+static void pool_checked_out(MemoryPool* pool, size_t count) {
+    size_t out = atomic_fetch_add_explicit(&pool->checked_out, count, memory_order_relaxed);
+    pool_raise_peak(pool, out + count);
+}
+
+static void pool_checked_in(MemoryPool* pool, size_t count) {
+    atomic_fetch_sub_explicit(&pool->checked_out, count, memory_order_relaxed);
+}
+
+static size_t pool_cache_carve(MemoryPool* pool, PoolThreadCache* cache);
+
+// Refills an empty cache from the depot, falling back to whatever the shared
+// slot holds and finally to never-used blocks. Returns the number of blocks
+// now loaded.
+static size_t pool_cache_refill(MemoryPool* pool, PoolThreadCache* cache) {
+    uint8_t* batch = pool_depot_pop(&pool->depot);
+    if (batch) {
+        cache->loaded = batch;
+        atomic_store_explicit(&cache->loaded_count, POOL_MAGAZINE_SIZE, memory_order_relaxed);
+        pool_checked_out(pool, POOL_MAGAZINE_SIZE);
+        return POOL_MAGAZINE_SIZE;
+    }
+
+    PoolThreadCache* shared = &pool->caches[POOL_SHARED_SLOT];
+    if (cache != shared) {
+        size_t count = 0;
+        pool_shared_lock(pool);
+        if (atomic_load_explicit(&shared->previous_count, memory_order_relaxed) > 0) {
+            cache->loaded = shared->previous;
+            count = atomic_load_explicit(&shared->previous_count, memory_order_relaxed);
+            shared->previous = NULL;
+            atomic_store_explicit(&shared->previous_count, 0, memory_order_relaxed);
+        } else if (atomic_load_explicit(&shared->loaded_count, memory_order_relaxed) > 0) {
+            cache->loaded = shared->loaded;
+            count = atomic_load_explicit(&shared->loaded_count, memory_order_relaxed);
+            shared->loaded = NULL;
+            atomic_store_explicit(&shared->loaded_count, 0, memory_order_relaxed);
+        }
+        pool_shared_unlock(pool);
+
+        if (count > 0) {
+            atomic_store_explicit(&cache->loaded_count, count, memory_order_relaxed);
+            return count;
+        }
+    }
+
+    return pool_cache_carve(pool, cache);
+}
+
+static void* pool_cache_pop(MemoryPool* pool, PoolThreadCache* cache) {
+    size_t count = atomic_load_explicit(&cache->loaded_count, memory_order_relaxed);
+    if (count == 0) {
+        size_t prev = atomic_load_explicit(&cache->previous_count, memory_order_relaxed);
+        if (prev > 0) {
+            cache->loaded = cache->previous;
+            cache->previous = NULL;
+            atomic_store_explicit(&cache->previous_count, 0, memory_order_relaxed);
+            count = prev;
+        } else {
+            count = pool_cache_refill(pool, cache);
+            if (count == 0) return NULL;
+        }
+    }
+
+    uint8_t* block = cache->loaded;
+    cache->loaded = *((uint8_t**)block);
+    atomic_store_explicit(&cache->loaded_count, count - 1, memory_order_relaxed);
+    return block;
+}
+
+static void pool_cache_push(MemoryPool* pool, PoolThreadCache* cache, uint8_t* block) {
+    size_t count = atomic_load_explicit(&cache->loaded_count, memory_order_relaxed);
+    if (count == POOL_MAGAZINE_SIZE) {
+        if (atomic_load_explicit(&cache->previous_count, memory_order_relaxed) > 0) {
+            pool_depot_push(&pool->depot, cache->previous);
+            pool_checked_in(pool, POOL_MAGAZINE_SIZE);
+        }
+        cache->previous = cache->loaded;
+        atomic_store_explicit(&cache->previous_count, POOL_MAGAZINE_SIZE, memory_order_relaxed);
+        cache->loaded = NULL;
+        count = 0;
+    }
+
+    *((uint8_t**)block) = cache->loaded;
+    cache->loaded = block;
+    atomic_store_explicit(&cache->loaded_count, count + 1, memory_order_relaxed);
+}
+
+// Moves everything a departing thread cached back into the pool: full
+// magazines go to the depot, a partial one is merged into the shared slot.
+static void pool_cache_flush(MemoryPool* pool, PoolThreadCache* cache) {
+    if (atomic_load_explicit(&cache->previous_count, memory_order_relaxed) > 0) {
+        pool_depot_push(&pool->depot, cache->previous);
+        pool_checked_in(pool, POOL_MAGAZINE_SIZE);
+        cache->previous = NULL;
+        atomic_store_explicit(&cache->previous_count, 0, memory_order_relaxed);
+    }
+
+    size_t count = atomic_load_explicit(&cache->loaded_count, memory_order_relaxed);
+    if (count == POOL_MAGAZINE_SIZE) {
+        pool_depot_push(&pool->depot, cache->loaded);
+        pool_checked_in(pool, POOL_MAGAZINE_SIZE);
+    } else if (count > 0) {
+        PoolThreadCache* shared = &pool->caches[POOL_SHARED_SLOT];
+        pool_shared_lock(pool);
+        uint8_t* block = cache->loaded;
+        for (size_t i = 0; i < count; i++) {
+            uint8_t* next = *((uint8_t**)block);
+            pool_cache_push(pool, shared, block);
+            block = next;
+        }
+        pool_shared_unlock(pool);
+    }
+    cache->loaded = NULL;
+    atomic_store_explicit(&cache->loaded_count, 0, memory_order_relaxed);
+}
+
+static void pool_thread_exit(void* value) {
+    int slot = (int)((intptr_t)value - 1);
+
+    pthread_mutex_lock(&pool_registry_lock);
+    for (MemoryPool* pool = pool_registry; pool; pool = pool->registry_next) {
+        pool_cache_flush(pool, &pool->caches[slot]);
+    }
+    pool_free_slots[pool_free_slot_count++] = slot;
+    pthread_mutex_unlock(&pool_registry_lock);
+}
+
+static void pool_tls_init(void) {
+    pthread_key_create(&pool_tls_key, pool_thread_exit);
+}
+
+static int pool_acquire_slot(void) {
+    pthread_once(&pool_tls_once, pool_tls_init);
+
+    int slot = POOL_SHARED_SLOT;
+    pthread_mutex_lock(&pool_registry_lock);
+    if (pool_free_slot_count > 0) {
+        slot = pool_free_slots[--pool_free_slot_count];
+    } else if (pool_next_slot < POOL_MAX_THREADS) {
+        slot = pool_next_slot++;
+    }
+    pthread_mutex_unlock(&pool_registry_lock);
+
+    if (slot != POOL_SHARED_SLOT) {
+        pthread_setspecific(pool_tls_key, (void*)((intptr_t)slot + 1));
+    }
+    pool_thread_slot = slot;
+    return slot;
+}
+
+static size_t pool_round_up(size_t n, size_t align) {
+    return (n + align - 1) & ~(align - 1);
+}
+
+// Returns `bytes` of memory aligned to the pool's alignment. Anonymous
+// mappings are over-reserved and trimmed when the alignment exceeds a page.
+static uint8_t* pool_slab_memory(const MemoryPool* pool, size_t bytes, size_t* map_size) {
+    size_t align = pool->alignment > sizeof(void*) ? pool->alignment : sizeof(void*);
+    *map_size = 0;
+
+    if (!(pool->flags & (POOL_FLAG_MMAP | POOL_FLAG_HUGE_PAGES))) {
+        return aligned_alloc(align, pool_round_up(bytes, align));
+    }
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t length = pool_round_up(bytes, page);
+    if (pool->flags & POOL_FLAG_HUGE_PAGES) {
+        length = pool_round_up(bytes, POOL_HUGE_PAGE_SIZE);
+        if (align < POOL_HUGE_PAGE_SIZE) align = POOL_HUGE_PAGE_SIZE;
+    }
+    size_t slack = align > page ? align - page : 0;
+
+    uint8_t* raw = mmap(NULL, length + slack, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return NULL;
+
+    uint8_t* start = raw;
+    if (slack > 0) {
+        start = (uint8_t*)pool_round_up((uintptr_t)raw, align);
+        if (start > raw) munmap(raw, (size_t)(start - raw));
+        size_t tail = (size_t)((raw + length + slack) - (start + length));
+        if (tail > 0) munmap(start + length, tail);
+    }
+
+#ifdef MADV_HUGEPAGE
+    if (pool->flags & POOL_FLAG_HUGE_PAGES) {
+        madvise(start, length, MADV_HUGEPAGE);
+    }
+#endif
+
+    *map_size = length;
+    return start;
+}
+
+static void pool_slab_destroy(PoolSlab* slab);
+
+// Wraps `memory` when given, otherwise allocates the slab's own storage
+static PoolSlab* pool_slab_create(const MemoryPool* pool, size_t block_count, void* memory) {
+    PoolSlab* slab = malloc(sizeof(PoolSlab));
+    if (!slab) return NULL;
+
+    slab->borrowed = memory != NULL;
+    slab->map_size = 0;
+    slab->memory = memory ? memory
+                          : pool_slab_memory(pool, pool->block_size * block_count, &slab->map_size);
+    if (!slab->memory) {
+        free(slab);
+        return NULL;
+    }
+
+    slab->block_count = block_count;
+    slab->free_count = block_count;
+    slab->free_list = NULL;
+    slab->prev_partial = NULL;
+    slab->next_partial = NULL;
+    atomic_init(&slab->bump, 0);
+
+#ifdef POOL_DEBUG
+    slab->live = calloc((block_count + 63) / 64, sizeof(uint64_t));
+    if (!slab->live) {
+        pool_slab_destroy(slab);
+        return NULL;
+    }
+#endif
+
+    return slab;
+}
+
+static void pool_slab_destroy(PoolSlab* slab) {
+#ifdef POOL_DEBUG
+    free(slab->live);
+#endif
+    if (slab->borrowed) {
+        // Owned by the caller
+    } else if (slab->map_size > 0) {
+        munmap(slab->memory, slab->map_size);
+    } else {
+        free(slab->memory);
+    }
+    free(slab);
+}
+
+// Copies `old` with `add` inserted in address order and `remove` left out
+static PoolSlabTable* pool_table_with(const PoolSlabTable* old, PoolSlab* add, const PoolSlab* remove) {
+    size_t count = (old ? old->count : 0) + (add ? 1 : 0) - (remove ? 1 : 0);
+    PoolSlabTable* table = malloc(sizeof(PoolSlabTable) + count * sizeof(PoolSlab*));
+    if (!table) return NULL;
+
+    table->retired_next = NULL;
+    table->count = 0;
+    bool placed = (add == NULL);
+    for (size_t i = 0; old && i < old->count; i++) {
+        PoolSlab* slab = old->slabs[i];
+        if (slab == remove) continue;
+        if (!placed && (uintptr_t)add->memory < (uintptr_t)slab->memory) {
+            table->slabs[table->count++] = add;
+            placed = true;
+        }
+        table->slabs[table->count++] = slab;
+    }
+    if (!placed) table->slabs[table->count++] = add;
+    return table;
+}
+
+static void pool_table_publish(MemoryPool* pool, PoolSlabTable* table) {
+    PoolSlabTable* old = atomic_load_explicit(&pool->table, memory_order_relaxed);
+    atomic_store_explicit(&pool->table, table, memory_order_release);
+    if (!old) return;
+
+    if (pool->flags & POOL_FLAG_CONCURRENT) {
+        // Another thread may still be searching the old table
+        old->retired_next = pool->retired;
+        pool->retired = old;
+    } else {
+        free(old);
+    }
+}
+
+static PoolSlab* pool_find_slab(const MemoryPool* pool, const void* ptr) {
+    const PoolSlabTable* table = atomic_load_explicit(&pool->table, memory_order_acquire);
+    uintptr_t p = (uintptr_t)ptr;
+
+    size_t lo = 0;
+    size_t hi = table->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if ((uintptr_t)table->slabs[mid]->memory <= p) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == 0) return NULL;
+
+    PoolSlab* slab = table->slabs[lo - 1];
+    uintptr_t end = (uintptr_t)slab->memory + slab->block_count * pool->block_size;
+    return p < end ? slab : NULL;
+}
+
+static void pool_partial_link(MemoryPool* pool, PoolSlab* slab) {
+    slab->prev_partial = NULL;
+    slab->next_partial = pool->partial;
+    if (pool->partial) pool->partial->prev_partial = slab;
+    pool->partial = slab;
+}
+
+static void pool_partial_unlink(MemoryPool* pool, PoolSlab* slab) {
+    if (slab->prev_partial) {
+        slab->prev_partial->next_partial = slab->next_partial;
+    } else {
+        pool->partial = slab->next_partial;
+    }
+    if (slab->next_partial) slab->next_partial->prev_partial = slab->prev_partial;
+    slab->prev_partial = NULL;
+    slab->next_partial = NULL;
+}
+
+// Size of the next slab: doubles current capacity, clamped to the ceiling
+static size_t pool_next_slab_count(const MemoryPool* pool) {
+    size_t capacity = atomic_load_explicit(&pool->block_count, memory_order_relaxed);
+    size_t count = capacity > pool->initial_count ? capacity : pool->initial_count;
+    if (pool->max_block_count > 0) {
+        if (capacity >= pool->max_block_count) return 0;
+        size_t room = pool->max_block_count - capacity;
+        if (count > room) count = room;
+    }
+    return count;
+}
+
+static PoolSlab* pool_grow(MemoryPool* pool) {
+    size_t count = pool_next_slab_count(pool);
+    if (count == 0) return NULL;
+
+    PoolSlab* slab = pool_slab_create(pool, count, NULL);
+    if (!slab) return NULL;
+
+    PoolSlabTable* table = pool_table_with(atomic_load_explicit(&pool->table, memory_order_relaxed),
+                                           slab, NULL);
+    if (!table) {
+        pool_slab_destroy(slab);
+        return NULL;
+    }
+    pool_table_publish(pool, table);
+
+    atomic_fetch_add_explicit(&pool->block_count, count, memory_order_relaxed);
+    pool->free_count += count;
+    pool->empty_slabs++;
+    pool_partial_link(pool, slab);
+    return slab;
+}
+
+// Called when the last block of a slab comes back. One fully free slab is
+// kept as headroom; any further ones (other than the initial slab) are
+// returned to the system.
+static void pool_slab_emptied(MemoryPool* pool, PoolSlab* slab) {
+    pool->empty_slabs++;
+    if (!(pool->flags & POOL_FLAG_GROWABLE) || pool->empty_slabs < 2 || slab == pool->base_slab) {
+        return;
+    }
+
+    PoolSlabTable* table = pool_table_with(atomic_load_explicit(&pool->table, memory_order_relaxed),
+                                           NULL, slab);
+    if (!table) return;
+    pool_table_publish(pool, table);
+
+    pool_partial_unlink(pool, slab);
+    atomic_fetch_sub_explicit(&pool->block_count, slab->block_count, memory_order_relaxed);
+    pool->free_count -= slab->block_count;
+    pool->empty_slabs--;
+    pool_slab_destroy(slab);
+}
+
+// Adds a slab unless another thread already replaced `seen` while we waited
+// for the lock. Returns whether there is a newer slab to carve from.
+static bool pool_grow_concurrent(MemoryPool* pool, PoolSlab* seen) {
+    pthread_mutex_lock(&pool->grow_lock);
+
+    bool grown = atomic_load_explicit(&pool->carve_slab, memory_order_relaxed) != seen;
+    if (!grown) {
+        size_t count = pool_next_slab_count(pool);
+        PoolSlab* slab = count > 0 ? pool_slab_create(pool, count, NULL) : NULL;
+        PoolSlabTable* table = NULL;
+        if (slab) {
+            table = pool_table_with(atomic_load_explicit(&pool->table, memory_order_relaxed),
+                                    slab, NULL);
+        }
+        if (table) {
+            pool_table_publish(pool, table);
+            atomic_fetch_add_explicit(&pool->block_count, count, memory_order_relaxed);
+            atomic_store_explicit(&pool->carve_slab, slab, memory_order_release);
+            grown = true;
+        } else if (slab) {
+            pool_slab_destroy(slab);
+        }
+    }
+
+    pthread_mutex_unlock(&pool->grow_lock);
+    return grown;
+}
+
+// Claims up to one magazine of never-used blocks from the newest slab,
+// growing the pool when that slab is used up.
+static size_t pool_cache_carve(MemoryPool* pool, PoolThreadCache* cache) {
+    for (;;) {
+        PoolSlab* slab = atomic_load_explicit(&pool->carve_slab, memory_order_acquire);
+        size_t start = atomic_fetch_add_explicit(&slab->bump, POOL_MAGAZINE_SIZE,
+                                                 memory_order_relaxed);
+        if (start < slab->block_count) {
+            size_t count = slab->block_count - start;
+            if (count > POOL_MAGAZINE_SIZE) count = POOL_MAGAZINE_SIZE;
+
+            uint8_t* first = slab->memory + (start * pool->block_size);
+            for (size_t i = 0; i + 1 < count; i++) {
+                uint8_t* current = first + (i * pool->block_size);
+                *((void**)current) = current + pool->block_size;
+            }
+            cache->loaded = first;
+            atomic_store_explicit(&cache->loaded_count, count, memory_order_relaxed);
+            pool_checked_out(pool, count);
+            return count;
+        }
+
+        if (!(pool->flags & POOL_FLAG_GROWABLE) || !pool_grow_concurrent(pool, slab)) {
+            return 0;
+        }
+    }
+}
+
+static bool pool_init_concurrent(MemoryPool* pool, PoolSlab* slab) {
+    size_t cache_bytes = sizeof(PoolThreadCache) * (POOL_MAX_THREADS + 1);
+    pool->caches = aligned_alloc(POOL_CACHE_LINE, cache_bytes);
+    if (!pool->caches) return false;
+    memset(pool->caches, 0, cache_bytes);
+
+    size_t ceiling = (pool->flags & POOL_FLAG_GROWABLE) ? pool->max_block_count
+                                                        : slab->block_count;
+    size_t node_count = ceiling / POOL_MAGAZINE_SIZE + POOL_MAX_THREADS + 2;
+    pool->depot.nodes = node_count <= UINT32_MAX ? malloc(sizeof(PoolBatchNode) * node_count)
+                                                 : NULL;
+    if (!pool->depot.nodes) {
+        free(pool->caches);
+        return false;
+    }
+    atomic_init(&pool->depot.full, 0);
+    atomic_init(&pool->depot.spare, 0);
+    atomic_init(&pool->depot.fresh, 0);
+    atomic_init(&pool->depot.batches, 0);
+    atomic_flag_clear(&pool->shared_lock);
+    pthread_mutex_init(&pool->grow_lock, NULL);
+    atomic_init(&pool->carve_slab, slab);
+
+    pthread_mutex_lock(&pool_registry_lock);
+    pool->registry_next = pool_registry;
+    pool_registry = pool;
+    pthread_mutex_unlock(&pool_registry_lock);
+    return true;
+}
+
+#ifdef POOL_DEBUG
+static void pool_debug_report(const MemoryPool* pool, const char* what, const void* ptr) {
+    fprintf(stderr, "memory_pool %p: %s %p\n", (const void*)pool, what, ptr);
+}
+
+static void pool_debug_on_alloc(MemoryPool* pool, void* block) {
+    PoolSlab* slab = pool_find_slab(pool, block);
+    size_t index = (size_t)((uint8_t*)block - slab->memory) / pool->block_size;
+    atomic_fetch_or_explicit(&slab->live[index / 64], (uint64_t)1 << (index % 64),
+                             memory_order_relaxed);
+}
+
+// Rejects misaligned and double frees; poisons the block otherwise
+static bool pool_debug_on_free(MemoryPool* pool, PoolSlab* slab, void* block) {
+    size_t offset = (size_t)((uint8_t*)block - slab->memory);
+    if (offset % pool->block_size != 0) {
+        atomic_fetch_add_explicit(&pool->invalid_frees, 1, memory_order_relaxed);
+        pool_debug_report(pool, "misaligned free of", block);
+        return false;
+    }
+
+    size_t index = offset / pool->block_size;
+    uint64_t bit = (uint64_t)1 << (index % 64);
+    uint64_t old = atomic_fetch_and_explicit(&slab->live[index / 64], ~bit, memory_order_relaxed);
+    if (!(old & bit)) {
+        atomic_fetch_add_explicit(&pool->invalid_frees, 1, memory_order_relaxed);
+        pool_debug_report(pool, "double free of", block);
+        return false;
+    }
+
+    memset(block, POOL_POISON_BYTE, pool->block_size);
+    return true;
+}
+
+static void pool_debug_check_leaks(const MemoryPool* pool) {
+    const PoolSlabTable* table = atomic_load_explicit(&pool->table, memory_order_relaxed);
+    size_t leaked = 0;
+    for (size_t i = 0; i < table->count; i++) {
+        const PoolSlab* slab = table->slabs[i];
+        for (size_t index = 0; index < slab->block_count; index++) {
+            uint64_t word = atomic_load_explicit(&slab->live[index / 64], memory_order_relaxed);
+            if (!(word & ((uint64_t)1 << (index % 64)))) continue;
+            if (leaked++ < 8) {
+                pool_debug_report(pool, "leaked block", slab->memory + index * pool->block_size);
+            }
+        }
+    }
+    if (leaked > 0) {
+        fprintf(stderr, "memory_pool %p: %zu block(s) still allocated at destroy\n",
+                (const void*)pool, leaked);
+    }
+}
+#endif // POOL_DEBUG
+
 MemoryPool* pool_create(size_t block_size, size_t block_count) {
+    PoolOptions opts = { .block_size = block_size, .block_count = block_count };
+    return pool_create_ex(&opts);
+}
+
+MemoryPool* pool_create_ex(const PoolOptions* opts) {
+    if (!opts || opts->block_count == 0) return NULL;
+
+    bool growable = (opts->flags & POOL_FLAG_GROWABLE) != 0;
+    if (growable && opts->max_block_count > 0 && opts->max_block_count < opts->block_count) {
+        return NULL;
+    }
+    if (growable && (opts->flags & POOL_FLAG_CONCURRENT) && opts->max_block_count == 0) {
+        return NULL; // The depot is sized for the ceiling up front
+    }
+    if (opts->alignment & (opts->alignment - 1)) {
+        return NULL; // Not a power of two
+    }
+    if (opts->memory) {
+        if (growable || (opts->flags & (POOL_FLAG_MMAP | POOL_FLAG_HUGE_PAGES))) return NULL;
+        if (opts->alignment > 0 && (uintptr_t)opts->memory % opts->alignment != 0) return NULL;
+    }
+
+    size_t block_size = opts->block_size;
     if (block_size < sizeof(void*)) {
         block_size = sizeof(void*);
     }
+    if (opts->alignment > 0) {
+        block_size = pool_round_up(block_size, opts->alignment);
+    }
 
-    MemoryPool* pool = malloc(sizeof(MemoryPool));
+    size_t pool_bytes = (sizeof(MemoryPool) + POOL_CACHE_LINE - 1) & ~(size_t)(POOL_CACHE_LINE - 1);
+    MemoryPool* pool = aligned_alloc(POOL_CACHE_LINE, pool_bytes);
     if (!pool) return NULL;
+    memset(pool, 0, sizeof(MemoryPool));
+
+    pool->block_size = block_size;
+    pool->alignment = opts->alignment;
+    pool->initial_count = opts->block_count;
+    pool->max_block_count = growable ? opts->max_block_count : opts->block_count;
+    pool->flags = opts->flags;
 
-    pool->memory = malloc(block_size * block_count);
-    if (!pool->memory) {
+    PoolSlab* slab = pool_slab_create(pool, opts->block_count, opts->memory);
+    PoolSlabTable* table = slab ? pool_table_with(NULL, slab, NULL) : NULL;
+    if (!table) {
+        if (slab) pool_slab_destroy(slab);
         free(pool);
         return NULL;
     }
+    atomic_init(&pool->table, table);
+    atomic_init(&pool->block_count, slab->block_count);
+    pool->base_slab = slab;
+    pool->free_count = slab->block_count;
+    pool->empty_slabs = 1;
+    pool_partial_link(pool, slab);
 
-    pool->block_size = block_size;
-    pool->block_count = block_count;
-    pool->free_count = block_count;
-
-    // Initialize free list - each block points to next
-    pool->free_list = pool->memory;
-    for (size_t i = 0; i < block_count - 1; i++) {
-        uint8_t* current = pool->memory + (i * block_size);
-        uint8_t* next = pool->memory + ((i + 1) * block_size);
-        *((void**)current) = next;
+    if ((pool->flags & POOL_FLAG_CONCURRENT) && !pool_init_concurrent(pool, slab)) {
+        pool_slab_destroy(slab);
+        free(table);
+        free(pool);
+        return NULL;
     }
-    *((void**)(pool->memory + (block_count - 1) * block_size)) = NULL;
 
     return pool;
 }
 
 void pool_destroy(MemoryPool* pool) {
     if (pool) {
-        free(pool->memory);
+#ifdef POOL_DEBUG
+        pool_debug_check_leaks(pool);
+#endif
+        if (pool->flags & POOL_FLAG_CONCURRENT) {
+            pthread_mutex_lock(&pool_registry_lock);
+            MemoryPool** link = &pool_registry;
+            while (*link && *link != pool) {
+                link = &(*link)->registry_next;
+            }
+            if (*link) *link = pool->registry_next;
+            pthread_mutex_unlock(&pool_registry_lock);
+
+            while (pool->retired) {
+                PoolSlabTable* next = pool->retired->retired_next;
+                free(pool->retired);
+                pool->retired = next;
+            }
+            pthread_mutex_destroy(&pool->grow_lock);
+            free(pool->depot.nodes);
+            free(pool->caches);
+        }
+
+        PoolSlabTable* table = atomic_load_explicit(&pool->table, memory_order_relaxed);
+        for (size_t i = 0; i < table->count; i++) {
+            pool_slab_destroy(table->slabs[i]);
+        }
+        free(table);
         free(pool);
     }
 }
 
-void* pool_alloc(MemoryPool* pool) {
-    if (!pool || !pool->free_list) {
-        return NULL;
+static void* pool_alloc_concurrent(MemoryPool* pool) {
+    int slot = pool_thread_slot;
+    if (slot < 0) slot = pool_acquire_slot();
+
+    PoolThreadCache* cache = &pool->caches[slot];
+    if (slot != POOL_SHARED_SLOT) {
+        void* block = pool_cache_pop(pool, cache);
+        if (block) pool_owner_add(&cache->allocs, 1);
+        return block;
     }
 
-    void* block = pool->free_list;
-    pool->free_list = *((uint8_t**)pool->free_list);
+    pool_shared_lock(pool);
+    void* block = pool_cache_pop(pool, cache);
+    if (block) pool_owner_add(&cache->allocs, 1);
+    pool_shared_unlock(pool);
+    return block;
+}
+
+static void* pool_alloc_local(MemoryPool* pool) {
+    PoolSlab* slab = pool->partial;
+    if (!slab) {
+        if (!(pool->flags & POOL_FLAG_GROWABLE)) return NULL;
+        slab = pool_grow(pool);
+        if (!slab) return NULL;
+    }
+
+    if (slab->free_count == slab->block_count) {
+        pool->empty_slabs--;
+    }
+
+    void* block = slab->free_list;
+    if (block) {
+        slab->free_list = *((uint8_t**)block);
+    } else {
+        size_t index = atomic_load_explicit(&slab->bump, memory_order_relaxed);
+        atomic_store_explicit(&slab->bump, index + 1, memory_order_relaxed);
+        block = slab->memory + (index * pool->block_size);
+    }
+    slab->free_count--;
     pool->free_count--;
 
+    if (slab->free_count == 0) {
+        pool_partial_unlink(pool, slab);
+    }
+
+    pool->total_allocs++;
+    size_t in_use = atomic_load_explicit(&pool->block_count, memory_order_relaxed) - pool->free_count;
+    if (in_use > atomic_load_explicit(&pool->peak_in_use, memory_order_relaxed)) {
+        atomic_store_explicit(&pool->peak_in_use, in_use, memory_order_relaxed);
+    }
+
+    return block;
+}
+
+void* pool_alloc(MemoryPool* pool) {
+    if (!pool) return NULL;
+
+    void* block = (pool->flags & POOL_FLAG_CONCURRENT) ? pool_alloc_concurrent(pool)
+                                                       : pool_alloc_local(pool);
+    if (!block) {
+        atomic_fetch_add_explicit(&pool->failed_allocs, 1, memory_order_relaxed);
+        return NULL;
+    }
+
+#ifdef POOL_DEBUG
+    pool_debug_on_alloc(pool, block);
+#endif
     return block;
 }
 
+static void pool_free_concurrent(MemoryPool* pool, void* block) {
+    int slot = pool_thread_slot;
+    if (slot < 0) slot = pool_acquire_slot();
+
+    PoolThreadCache* cache = &pool->caches[slot];
+    if (slot != POOL_SHARED_SLOT) {
+        pool_cache_push(pool, cache, block);
+        pool_owner_add(&cache->frees, 1);
+        return;
+    }
+
+    pool_shared_lock(pool);
+    pool_cache_push(pool, cache, block);
+    pool_owner_add(&cache->frees, 1);
+    pool_shared_unlock(pool);
+}
+
+static void pool_free_local(MemoryPool* pool, PoolSlab* slab, void* block) {
+    if (slab->free_count == 0) {
+        pool_partial_link(pool, slab);
+    }
+
+    *((void**)block) = slab->free_list;
+    slab->free_list = block;
+    slab->free_count++;
+    pool->free_count++;
+    pool->total_frees++;
+
+    if (slab->free_count == slab->block_count) {
+        pool_slab_emptied(pool, slab);
+    }
+}
+
 void pool_free(MemoryPool* pool, void* block) {
     if (!pool || !block) return;
 
     // Verify block belongs to this pool
-    uint8_t* ptr = (uint8_t*)block;
-    if (ptr < pool->memory || ptr >= pool->memory + (pool->block_size * pool->block_count)) {
+    PoolSlab* slab = pool_find_slab(pool, block);
+    if (!slab) {
+        atomic_fetch_add_explicit(&pool->invalid_frees, 1, memory_order_relaxed);
         return; // Block not from this pool
     }
 
-    *((void**)block) = pool->free_list;
-    pool->free_list = block;
-    pool->free_count++;
+#ifdef POOL_DEBUG
+    if (!pool_debug_on_free(pool, slab, block)) return;
+#endif
+
+    if (pool->flags & POOL_FLAG_CONCURRENT) {
+        pool_free_concurrent(pool, block);
+    } else {
+        pool_free_local(pool, slab, block);
+    }
 }
 
 size_t pool_available(const MemoryPool* pool) {
-    return pool ? pool->free_count : 0;
+    if (!pool) return 0;
+    if (!(pool->flags & POOL_FLAG_CONCURRENT)) return pool->free_count;
+
+    // Snapshot: exact when no other thread is allocating or freeing
+    size_t total = pool_depot_blocks(&pool->depot);
+    for (size_t i = 0; i <= POOL_MAX_THREADS; i++) {
+        const PoolThreadCache* cache = &pool->caches[i];
+        total += atomic_load_explicit(&cache->loaded_count, memory_order_relaxed);
+        total += atomic_load_explicit(&cache->previous_count, memory_order_relaxed);
+    }
+    const PoolSlabTable* table = atomic_load_explicit(&pool->table, memory_order_acquire);
+    for (size_t i = 0; i < table->count; i++) {
+        const PoolSlab* slab = table->slabs[i];
+        size_t bump = atomic_load_explicit(&slab->bump, memory_order_relaxed);
+        if (bump < slab->block_count) total += slab->block_count - bump;
+    }
+    size_t capacity = atomic_load_explicit(&pool->block_count, memory_order_relaxed);
+    return total < capacity ? total : capacity;
 }
 
 bool pool_contains(const MemoryPool* pool, const void* ptr) {
     if (!pool || !ptr) return false;
-    const uint8_t* p = (const uint8_t*)ptr;
-    return p >= pool->memory && p < pool->memory + (pool->block_size * pool->block_count);
+    return pool_find_slab(pool, ptr) != NULL;
+}
+
+void pool_stats(const MemoryPool* pool, PoolStats* out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (!pool) return;
+
+    out->capacity = atomic_load_explicit(&pool->block_count, memory_order_relaxed);
+    out->peak_in_use = atomic_load_explicit(&pool->peak_in_use, memory_order_relaxed);
+    out->failed_allocs = atomic_load_explicit(&pool->failed_allocs, memory_order_relaxed);
+    out->invalid_frees = atomic_load_explicit(&pool->invalid_frees, memory_order_relaxed);
+
+    if (!(pool->flags & POOL_FLAG_CONCURRENT)) {
+        out->in_use = out->capacity - pool->free_count;
+        out->total_allocs = pool->total_allocs;
+        out->total_frees = pool->total_frees;
+        return;
+    }
+
+    for (size_t i = 0; i <= POOL_MAX_THREADS; i++) {
+        const PoolThreadCache* cache = &pool->caches[i];
+        out->total_allocs += atomic_load_explicit(&cache->allocs, memory_order_relaxed);
+        out->total_frees += atomic_load_explicit(&cache->frees, memory_order_relaxed);
+    }
+    // A free can be counted before the matching alloc in a racing snapshot
+    out->in_use = out->total_allocs > out->total_frees ? out->total_allocs - out->total_frees : 0;
+    if (out->in_use > out->peak_in_use) out->peak_in_use = out->in_use;
 }
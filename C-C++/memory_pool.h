@@ -8,11 +8,63 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 typedef struct MemoryPool MemoryPool;
 
+typedef enum {
+    POOL_FLAG_NONE       = 0,
+    POOL_FLAG_CONCURRENT = 1 << 0,  // Safe to alloc/free from any thread
+    POOL_FLAG_GROWABLE   = 1 << 1,  // Add slabs on demand instead of failing
+    POOL_FLAG_MMAP       = 1 << 2,  // Back slabs with anonymous mmap, not malloc
+    POOL_FLAG_HUGE_PAGES = 1 << 3   // mmap with MADV_HUGEPAGE (implies MMAP)
+} PoolFlags;
+
+typedef struct {
+    size_t block_size;
+    size_t block_count;             // Initial capacity
+    unsigned flags;                 // Bitwise OR of PoolFlags
+    size_t max_block_count;         // GROWABLE: capacity ceiling, 0 = unbounded
+    size_t alignment;               // Block alignment (power of two), 0 = default
+    void* memory;                   // Optional caller-owned backing (see below)
+} PoolOptions;
+
+typedef struct {
+    size_t capacity;                // Blocks currently backed by slabs
+    size_t in_use;
+    size_t peak_in_use;
+    size_t total_allocs;
+    size_t total_frees;
+    size_t failed_allocs;           // pool_alloc calls that returned NULL
+    size_t invalid_frees;           // Foreign pointers; misaligned/double frees with POOL_DEBUG
+} PoolStats;
+
 // TODO: Document this function
 MemoryPool* pool_create(size_t block_size, size_t block_count);
 
+// Creates a pool described by opts. Returns NULL on bad options or OOM.
+// Creation is O(1) in block_count: blocks are handed out from a bump pointer
+// until first freed, so untouched memory is never written (and, with
+// POOL_FLAG_MMAP, never faulted in). A non-zero alignment rounds the block
+// stride up so that every block starts on that boundary.
+//
+// If memory is set, the pool carves its blocks out of that region (which must
+// hold block_count strides and honour alignment) instead of allocating, and
+// never frees it. Not combinable with GROWABLE, MMAP or HUGE_PAGES.
+//
+// With POOL_FLAG_CONCURRENT each thread allocates from and frees into its own
+// block cache without atomics; caches exchange fixed-size batches with a
+// shared lock-free depot only when they run empty or overflow.
+//
+// With POOL_FLAG_GROWABLE an exhausted pool adds a new slab, doubling its
+// capacity each time up to max_block_count. Once more than one slab is
+// completely free, the extras are released back to the system (the initial
+// slab is kept). Concurrent growable pools must set max_block_count and keep
+// their slabs until pool_destroy.
+MemoryPool* pool_create_ex(const PoolOptions* opts);
+
 // TODO: Document this function
 void pool_destroy(MemoryPool* pool);
 
@@ -28,4 +80,17 @@ size_t pool_available(const MemoryPool* pool);
 // TODO: Document this function
 bool pool_contains(const MemoryPool* pool, const void* ptr);
 
+// Fills out with a snapshot of the pool's counters without locking. In
+// concurrent mode the snapshot is exact when the pool is quiescent, and
+// peak_in_use also counts blocks parked in thread caches.
+//
+// Building with POOL_DEBUG defined additionally poisons freed blocks, rejects
+// (and reports on stderr) double and misaligned frees, and lists leaked
+// blocks in pool_destroy. Without it none of that code is compiled in.
+void pool_stats(const MemoryPool* pool, PoolStats* out);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif // MEMORY_POOL_H
@@ -0,0 +1,200 @@
+// pool_allocator.hpp
+// A standard Allocator backed by MemoryPool size classes
+#ifndef POOL_ALLOCATOR_HPP
+#define POOL_ALLOCATOR_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include "memory_pool.h"
+
+// Owns one growable MemoryPool per 16-byte size class up to 512 bytes. A
+// class pool is created the first time a block of its size is requested.
+// Larger or over-aligned requests go to the global operator new.
+class PoolResource {
+public:
+    static constexpr std::size_t granule = 16;
+    static constexpr std::size_t max_size = 512;
+    static constexpr std::size_t classes = max_size / granule;
+
+    // initial_blocks is the first slab size of every class pool. flags is
+    // passed to each pool (GROWABLE is always added); POOL_FLAG_CONCURRENT
+    // makes the resource safe to share between threads and requires a
+    // non-zero max_blocks, the per-class capacity ceiling.
+    explicit PoolResource(std::size_t initial_blocks = 64,
+                          unsigned flags = POOL_FLAG_NONE,
+                          std::size_t max_blocks = 0);
+
+    ~PoolResource();
+
+    // Returns storage for bytes with the given alignment. Throws
+    // std::bad_alloc when the class pool is at its ceiling.
+    void* allocate(std::size_t bytes, std::size_t alignment = alignof(std::max_align_t));
+
+    // Returns storage from allocate; bytes and alignment must match.
+    void deallocate(void* ptr, std::size_t bytes,
+                    std::size_t alignment = alignof(std::max_align_t)) noexcept;
+
+    // Non-copyable, non-movable
+    PoolResource(const PoolResource&) = delete;
+    PoolResource& operator=(const PoolResource&) = delete;
+    PoolResource(PoolResource&&) = delete;
+    PoolResource& operator=(PoolResource&&) = delete;
+
+private:
+    static bool pooled(std::size_t bytes, std::size_t alignment) noexcept;
+    static std::size_t class_index(std::size_t bytes) noexcept;
+    MemoryPool* class_pool(std::size_t index);
+
+    std::size_t initial_blocks_;
+    unsigned flags_;
+    std::size_t max_blocks_;
+    std::mutex create_mutex_;
+    std::atomic<MemoryPool*> pools_[classes] = {};
+};
+
+// Stateful allocator handing out storage from a PoolResource. Copies and
+// rebinds share the resource, so a container's node type, bucket array and
+// any other internal allocations all draw from the same pools. The resource
+// must outlive every container using it.
+template<typename T>
+class PoolAllocator {
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    template<typename U>
+    struct rebind {
+        using other = PoolAllocator<U>;
+    };
+
+    // Allocates from resource, which is not owned.
+    explicit PoolAllocator(PoolResource& resource) noexcept;
+
+    // Rebinding copy
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U>& other) noexcept;
+
+    // Returns storage for n objects of T (uninitialised).
+    T* allocate(size_type n);
+
+    // Returns storage obtained from allocate(n).
+    void deallocate(T* ptr, size_type n) noexcept;
+
+    // Returns the resource this allocator draws from.
+    PoolResource* resource() const noexcept;
+
+private:
+    PoolResource* resource_;
+};
+
+template<typename T, typename U>
+bool operator==(const PoolAllocator<T>& a, const PoolAllocator<U>& b) noexcept;
+
+template<typename T, typename U>
+bool operator!=(const PoolAllocator<T>& a, const PoolAllocator<U>& b) noexcept;
+
+// Implementation
+inline PoolResource::PoolResource(std::size_t initial_blocks, unsigned flags, std::size_t max_blocks)
+    : initial_blocks_(initial_blocks), flags_(flags | POOL_FLAG_GROWABLE), max_blocks_(max_blocks) {
+    if (initial_blocks == 0) {
+        throw std::invalid_argument("PoolResource initial_blocks must be > 0");
+    }
+    if ((flags & POOL_FLAG_CONCURRENT) && max_blocks == 0) {
+        throw std::invalid_argument("Concurrent PoolResource requires max_blocks");
+    }
+}
+
+inline PoolResource::~PoolResource() {
+    for (auto& pool : pools_) {
+        pool_destroy(pool.load(std::memory_order_relaxed));
+    }
+}
+
+inline bool PoolResource::pooled(std::size_t bytes, std::size_t alignment) noexcept {
+    return bytes <= max_size && alignment <= alignof(std::max_align_t);
+}
+
+inline std::size_t PoolResource::class_index(std::size_t bytes) noexcept {
+    return bytes == 0 ? 0 : (bytes - 1) / granule;
+}
+
+inline MemoryPool* PoolResource::class_pool(std::size_t index) {
+    MemoryPool* pool = pools_[index].load(std::memory_order_acquire);
+    if (pool) return pool;
+
+    std::lock_guard<std::mutex> lock(create_mutex_);
+    pool = pools_[index].load(std::memory_order_relaxed);
+    if (!pool) {
+        PoolOptions opts = {};
+        opts.block_size = (index + 1) * granule;
+        opts.block_count = initial_blocks_;
+        opts.flags = flags_;
+        opts.max_block_count = max_blocks_;
+        opts.alignment = alignof(std::max_align_t);
+        pool = pool_create_ex(&opts);
+        if (!pool) throw std::bad_alloc();
+        pools_[index].store(pool, std::memory_order_release);
+    }
+    return pool;
+}
+
+inline void* PoolResource::allocate(std::size_t bytes, std::size_t alignment) {
+    if (!pooled(bytes, alignment)) {
+        return ::operator new(bytes, std::align_val_t(alignment));
+    }
+    void* block = pool_alloc(class_pool(class_index(bytes)));
+    if (!block) throw std::bad_alloc();
+    return block;
+}
+
+inline void PoolResource::deallocate(void* ptr, std::size_t bytes, std::size_t alignment) noexcept {
+    if (!pooled(bytes, alignment)) {
+        ::operator delete(ptr, bytes, std::align_val_t(alignment));
+        return;
+    }
+    pool_free(pools_[class_index(bytes)].load(std::memory_order_relaxed), ptr);
+}
+
+template<typename T>
+PoolAllocator<T>::PoolAllocator(PoolResource& resource) noexcept : resource_(&resource) {}
+
+template<typename T>
+template<typename U>
+PoolAllocator<T>::PoolAllocator(const PoolAllocator<U>& other) noexcept : resource_(other.resource()) {}
+
+template<typename T>
+T* PoolAllocator<T>::allocate(size_type n) {
+    if (n > std::numeric_limits<size_type>::max() / sizeof(T)) {
+        throw std::bad_array_new_length();
+    }
+    return static_cast<T*>(resource_->allocate(n * sizeof(T), alignof(T)));
+}
+
+template<typename T>
+void PoolAllocator<T>::deallocate(T* ptr, size_type n) noexcept {
+    resource_->deallocate(ptr, n * sizeof(T), alignof(T));
+}
+
+template<typename T>
+PoolResource* PoolAllocator<T>::resource() const noexcept {
+    return resource_;
+}
+
+template<typename T, typename U>
+bool operator==(const PoolAllocator<T>& a, const PoolAllocator<U>& b) noexcept {
+    return a.resource() == b.resource();
+}
+
+template<typename T, typename U>
+bool operator!=(const PoolAllocator<T>& a, const PoolAllocator<U>& b) noexcept {
+    return !(a == b);
+}
+
+#endif // POOL_ALLOCATOR_HPP
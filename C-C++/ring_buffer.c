@@ -1,30 +1,331 @@
 // ring_buffer.c
+#define _GNU_SOURCE // memfd_create
 #include "ring_buffer.h"
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RING_SPIN_LIMIT 256
+#define RING_MAGIC      0x52494e47u     // "RING"
+
+static inline uint8_t* ring_data(const RingBuffer* rb) {
+    return (uint8_t*)rb + rb->data_offset;
+}
+
+// Buffer offset of a head or tail position
+static inline size_t ring_offset(const RingBuffer* rb, size_t pos) {
+    return rb->mask ? (pos & rb->mask) : pos;
+}
+
+static inline size_t ring_advance(const RingBuffer* rb, size_t pos, size_t len) {
+    if (rb->mask) return pos + len;
+    pos += len;
+    return pos >= rb->capacity ? pos - rb->capacity : pos;
+}
+
+static inline size_t ring_used(const RingBuffer* rb, size_t head, size_t tail) {
+    if (rb->mask || head >= tail) return head - tail;
+    return head + rb->capacity - tail;
+}
+
+static inline size_t ring_usable(const RingBuffer* rb) {
+    return rb->mask ? rb->capacity : rb->capacity - 1;
+}
+
+// Free space as seen by the producer. The consumer's tail is only re-read
+// when the cached copy leaves less than len bytes.
+static inline size_t ring_writable(RingBuffer* rb, size_t head, size_t len) {
+    size_t free = ring_usable(rb) - ring_used(rb, head, rb->cached_tail);
+    if (free < len) {
+        rb->cached_tail = atomic_load_explicit(&rb->tail, memory_order_acquire);
+        free = ring_usable(rb) - ring_used(rb, head, rb->cached_tail);
+    }
+    return free;
+}
+
+// Readable bytes as seen by the consumer, re-reading head only when needed
+static inline size_t ring_readable(RingBuffer* rb, size_t tail, size_t len) {
+    size_t available = ring_used(rb, rb->cached_head, tail);
+    if (available < len) {
+        rb->cached_head = atomic_load_explicit(&rb->head, memory_order_acquire);
+        available = ring_used(rb, rb->cached_head, tail);
+    }
+    return available;
+}
+
+// Rings in shared segments need process-shared futexes; all others can use
+// the cheaper private variant.
+static void ring_futex_wait(const RingBuffer* rb, atomic_uint* word, unsigned expected,
+                            const struct timespec* timeout) {
+    int op = rb->shared ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE;
+    syscall(SYS_futex, word, op, expected, timeout, NULL, 0);
+}
+
+static void ring_futex_wake(const RingBuffer* rb, atomic_uint* word) {
+    int op = rb->shared ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE;
+    syscall(SYS_futex, word, op, INT_MAX, NULL, NULL, 0);
+}
+
+// Wakes sleepers after an index store. The fence pairs with the one in
+// ring_wait so either the waiter sees the new index or we see its count;
+// the syscall is only made in the second case.
+static void ring_notify(const RingBuffer* rb, atomic_uint* waiters, atomic_uint* seq) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(waiters, memory_order_relaxed) != 0) {
+        atomic_fetch_add_explicit(seq, 1, memory_order_release);
+        ring_futex_wake(rb, seq);
+    }
+}
+
+static void ring_publish_head(RingBuffer* rb, size_t head) {
+    atomic_store_explicit(&rb->head, head, memory_order_release);
+    ring_notify(rb, &rb->data_waiters, &rb->data_seq);
+}
+
+static void ring_publish_tail(RingBuffer* rb, size_t tail) {
+    atomic_store_explicit(&rb->tail, tail, memory_order_release);
+    ring_notify(rb, &rb->space_waiters, &rb->space_seq);
+}
+
+// Copies into or out of the buffer in at most two contiguous segments
+static void ring_copy_in(RingBuffer* rb, size_t offset, const uint8_t* src, size_t len) {
+    size_t first = rb->mirrored ? len : rb->capacity - offset;
+    if (first > len) first = len;
+    uint8_t* buffer = ring_data(rb);
+    memcpy(buffer + offset, src, first);
+    memcpy(buffer, src + first, len - first);
+}
+
+static void ring_copy_out(const RingBuffer* rb, size_t offset, uint8_t* dst, size_t len) {
+    size_t first = rb->mirrored ? len : rb->capacity - offset;
+    if (first > len) first = len;
+    const uint8_t* buffer = ring_data(rb);
+    memcpy(dst, buffer + offset, first);
+    memcpy(dst + first, buffer, len - first);
+}
+
+// Splits len bytes starting at offset into the parts before and after the wrap
+static void ring_spans(const RingBuffer* rb, size_t offset, size_t len,
+                       RingSpan* first, RingSpan* second) {
+    size_t head_part = rb->mirrored ? len : rb->capacity - offset;
+    if (head_part > len) head_part = len;
+    first->data = ring_data(rb) + offset;
+    first->len = head_part;
+    second->data = ring_data(rb);
+    second->len = len - head_part;
+}
+
+// Fills in every control field of a ring whose data_size bytes of data start
+// data_offset bytes after rb. The magic number is left for the caller to
+// publish once the ring is ready.
+static void ring_init(RingBuffer* rb, size_t data_offset, size_t data_size, bool pow2) {
+    atomic_init(&rb->magic, 0);
+    rb->version = RING_VERSION;
+    rb->header_size = sizeof(RingBuffer);
+    rb->mirrored = false;
+    rb->mapped = false;
+    rb->shared = false;
+    rb->data_offset = data_offset;
+    rb->capacity = data_size;
+    rb->mask = pow2 ? data_size - 1 : 0;
+    atomic_init(&rb->head, 0);
+    atomic_init(&rb->tail, 0);
+    rb->cached_tail = 0;
+    rb->cached_head = 0;
+    atomic_init(&rb->data_waiters, 0);
+    atomic_init(&rb->data_seq, 0);
+    atomic_init(&rb->space_waiters, 0);
+    atomic_init(&rb->space_seq, 0);
+}
+
+// Rounds a POW2 capacity up; 0 if impossible
+static size_t ring_pow2_size(size_t capacity) {
+    if (capacity == 0 || capacity > (SIZE_MAX >> 1) + 1) return 0;
+    size_t size = 1;
+    while (size < capacity) size <<= 1;
+    return size;
+}
 
 RingBuffer* ring_create(size_t capacity) {
-    RingBuffer* rb = malloc(sizeof(RingBuffer));
+    return ring_create_ex(capacity, RING_FLAG_NONE);
+}
+
+RingBuffer* ring_create_ex(size_t capacity, unsigned flags) {
+    size_t size = capacity + 1;     // One extra byte to distinguish full from empty
+    if (flags & RING_FLAG_POW2) {
+        size = ring_pow2_size(capacity);
+        if (size == 0) return NULL;
+    }
+
+    // Header and data share one allocation; the header size is a multiple of
+    // the cache line, so the data starts on a line of its own
+    size_t header = sizeof(RingBuffer);
+    if (size > SIZE_MAX - header - RING_CACHE_LINE) return NULL;
+    size_t bytes = (header + size + RING_CACHE_LINE - 1) & ~(size_t)(RING_CACHE_LINE - 1);
+
+    RingBuffer* rb = aligned_alloc(RING_CACHE_LINE, bytes);
     if (!rb) return NULL;
 
-    // Allocate one extra byte to distinguish full from empty
-    rb->buffer = malloc(capacity + 1);
-    if (!rb->buffer) {
-        free(rb);
+    ring_init(rb, header, size, (flags & RING_FLAG_POW2) != 0);
+    atomic_store_explicit(&rb->magic, RING_MAGIC, memory_order_relaxed);
+    return rb;
+}
+
+// Bytes before the data in a mapped segment: the header rounded up to whole
+// pages, so the data can be mapped a second time at a page-aligned offset
+static size_t ring_segment_header(void) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    return (sizeof(RingBuffer) + page - 1) / page * page;
+}
+
+static size_t ring_segment_span(size_t data_offset, size_t data_size, bool mirror) {
+    return data_offset + data_size + (mirror ? data_size : 0);
+}
+
+// Maps header and data of the segment in fd. With mirror the data is mapped
+// once more right behind itself. Returns NULL on failure.
+static RingBuffer* ring_map_segment(int fd, size_t header, size_t data_size, bool mirror) {
+    if (data_size > (SIZE_MAX - header) / 2) return NULL;
+    size_t span = ring_segment_span(header, data_size, mirror);
+
+    // Reserve the whole span first so nothing else can land in between
+    uint8_t* base = mmap(NULL, span, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) return NULL;
+
+    void* view = mmap(base, header + data_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_FIXED, fd, 0);
+    if (view != MAP_FAILED && mirror) {
+        view = mmap(base + header + data_size, data_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_FIXED, fd, (off_t)header);
+    }
+    if (view == MAP_FAILED) {
+        munmap(base, span);
         return NULL;
     }
+    return (RingBuffer*)base;
+}
 
-    rb->capacity = capacity + 1;
-    atomic_init(&rb->head, 0);
-    atomic_init(&rb->tail, 0);
+// Sizes fd for a ring of at least capacity bytes and maps it, mirrored if
+// possible. Returns NULL on failure.
+static RingBuffer* ring_create_segment(int fd, size_t capacity) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t size = ring_pow2_size(capacity < page ? page : capacity);
+    size_t header = ring_segment_header();
+    if (size == 0 || size > SIZE_MAX - header) return NULL;
+    if (ftruncate(fd, (off_t)(header + size)) != 0) return NULL;
+
+    bool mirror = true;
+    RingBuffer* rb = ring_map_segment(fd, header, size, mirror);
+    if (!rb) {
+        mirror = false;
+        rb = ring_map_segment(fd, header, size, mirror);
+        if (!rb) return NULL;
+    }
+
+    ring_init(rb, header, size, true);
+    rb->mirrored = mirror;
+    rb->mapped = true;
+    return rb;
+}
+
+RingBuffer* ring_create_mirrored(size_t capacity) {
+    int fd = memfd_create("ring_buffer", MFD_CLOEXEC);
+    RingBuffer* rb = fd >= 0 ? ring_create_segment(fd, capacity) : NULL;
+    if (fd >= 0) close(fd); // The mapping keeps the memory alive
+
+    if (!rb || !rb->mirrored) {
+        ring_destroy(rb);
+        long page = sysconf(_SC_PAGESIZE);
+        if (page > 0 && capacity < (size_t)page) capacity = (size_t)page;
+        return ring_create_ex(capacity, RING_FLAG_POW2);
+    }
+
+    atomic_store_explicit(&rb->magic, RING_MAGIC, memory_order_relaxed);
+    return rb;
+}
+
+RingBuffer* ring_create_shared_fd(int fd, size_t capacity) {
+    RingBuffer* rb = ring_create_segment(fd, capacity);
+    if (!rb) return NULL;
+
+    rb->shared = true;
+    atomic_store_explicit(&rb->magic, RING_MAGIC, memory_order_release);
+    return rb;
+}
+
+RingBuffer* ring_create_shared(const char* name, size_t capacity) {
+    if (!name) return NULL;
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) return NULL;
 
+    RingBuffer* rb = ring_create_shared_fd(fd, capacity);
+    close(fd);
+    if (!rb) shm_unlink(name);
     return rb;
 }
 
+// Checks that a mapped header was written by a compatible creator and
+// describes a ring that fits in file_size bytes
+static bool ring_header_valid(const RingBuffer* rb, size_t file_size) {
+    if (atomic_load_explicit(&rb->magic, memory_order_acquire) != RING_MAGIC) return false;
+    if (rb->version != RING_VERSION || rb->header_size != sizeof(RingBuffer)) return false;
+    if (!rb->mapped || !rb->shared || rb->data_offset != ring_segment_header()) return false;
+    if (rb->capacity == 0 || (rb->capacity & (rb->capacity - 1)) || rb->mask != rb->capacity - 1) {
+        return false;
+    }
+    return rb->capacity <= file_size && rb->data_offset <= file_size - rb->capacity;
+}
+
+RingBuffer* ring_attach_fd(int fd) {
+    struct stat st;
+    size_t header = ring_segment_header();
+    if (fstat(fd, &st) != 0 || st.st_size < 0 || (size_t)st.st_size < header) return NULL;
+
+    // Map just the header to learn (and check) the geometry
+    RingBuffer* probe = mmap(NULL, header, PROT_READ, MAP_SHARED, fd, 0);
+    if (probe == MAP_FAILED) return NULL;
+    bool valid = ring_header_valid(probe, (size_t)st.st_size);
+    size_t size = probe->capacity;
+    bool mirror = probe->mirrored;
+    munmap(probe, header);
+    if (!valid) return NULL;
+
+    RingBuffer* rb = ring_map_segment(fd, header, size, mirror);
+    if (rb && !ring_header_valid(rb, (size_t)st.st_size)) {
+        munmap(rb, ring_segment_span(header, size, mirror));
+        return NULL;
+    }
+    return rb;
+}
+
+RingBuffer* ring_attach(const char* name) {
+    if (!name) return NULL;
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) return NULL;
+
+    RingBuffer* rb = ring_attach_fd(fd);
+    close(fd);
+    return rb;
+}
+
+bool ring_unlink(const char* name) {
+    return name && shm_unlink(name) == 0;
+}
+
 void ring_destroy(RingBuffer* rb) {
     if (rb) {
-        free(rb->buffer);
-        free(rb);
+        if (rb->mapped) {
+            munmap(rb, ring_segment_span(rb->data_offset, rb->capacity, rb->mirrored));
+        } else {
+            free(rb);
+        }
     }
 }
 
@@ -32,17 +333,11 @@ bool ring_push(RingBuffer* rb, const void* data, size_t len) {
     if (!rb || !data || len == 0) return false;
 
     size_t head = atomic_load_explicit(&rb->head, memory_order_relaxed);
-    size_t tail = atomic_load_explicit(&rb->tail, memory_order_acquire);
-
-    size_t free = (tail - head - 1 + rb->capacity) % rb->capacity;
-    if (len > free) return false;
+    if (len > ring_writable(rb, head, len)) return false;
 
-    const uint8_t* src = (const uint8_t*)data;
-    for (size_t i = 0; i < len; i++) {
-        rb->buffer[(head + i) % rb->capacity] = src[i];
-    }
+    ring_copy_in(rb, ring_offset(rb, head), (const uint8_t*)data, len);
 
-    atomic_store_explicit(&rb->head, (head + len) % rb->capacity, memory_order_release);
+    ring_publish_head(rb, ring_advance(rb, head, len));
     return true;
 }
 
@@ -50,30 +345,189 @@ bool ring_pop(RingBuffer* rb, void* data, size_t len) {
     if (!rb || !data || len == 0) return false;
 
     size_t tail = atomic_load_explicit(&rb->tail, memory_order_relaxed);
-    size_t head = atomic_load_explicit(&rb->head, memory_order_acquire);
+    if (len > ring_readable(rb, tail, len)) return false;
+
+    ring_copy_out(rb, ring_offset(rb, tail), (uint8_t*)data, len);
+
+    ring_publish_tail(rb, ring_advance(rb, tail, len));
+    return true;
+}
+
+// Retries op until it succeeds or timeout_ms passes: a short spin first, then
+// futex sleeps on seq with the waiter count raised so the other side wakes us.
+static bool ring_wait(RingBuffer* rb, void* data, size_t len, int timeout_ms,
+                      bool (*op)(RingBuffer*, void*, size_t),
+                      atomic_uint* waiters, atomic_uint* seq) {
+    for (int spin = 0; spin < RING_SPIN_LIMIT; spin++) {
+        if (op(rb, data, len)) return true;
+    }
+
+    struct timespec deadline = {0, 0};
+    if (timeout_ms >= 0) {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+
+    for (;;) {
+        unsigned observed = atomic_load_explicit(seq, memory_order_acquire);
+        atomic_fetch_add_explicit(waiters, 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+
+        bool done = op(rb, data, len);
+        if (!done) {
+            struct timespec remaining = {0, 0};
+            if (timeout_ms >= 0) {
+                struct timespec now;
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                remaining.tv_sec = deadline.tv_sec - now.tv_sec;
+                remaining.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+                if (remaining.tv_nsec < 0) {
+                    remaining.tv_sec--;
+                    remaining.tv_nsec += 1000000000L;
+                }
+            }
+            if (timeout_ms < 0 || remaining.tv_sec >= 0) {
+                ring_futex_wait(rb, seq, observed, timeout_ms < 0 ? NULL : &remaining);
+            } else {
+                atomic_fetch_sub_explicit(waiters, 1, memory_order_relaxed);
+                return false;
+            }
+        }
 
-    size_t available = (head - tail + rb->capacity) % rb->capacity;
-    if (len > available) return false;
+        atomic_fetch_sub_explicit(waiters, 1, memory_order_relaxed);
+        if (done) return true;
+    }
+}
+
+static bool ring_push_op(RingBuffer* rb, void* data, size_t len) {
+    return ring_push(rb, data, len);
+}
+
+static bool ring_pop_op(RingBuffer* rb, void* data, size_t len) {
+    return ring_pop(rb, data, len);
+}
 
-    uint8_t* dst = (uint8_t*)data;
-    for (size_t i = 0; i < len; i++) {
-        dst[i] = rb->buffer[(tail + i) % rb->capacity];
+bool ring_push_wait(RingBuffer* rb, const void* data, size_t len, int timeout_ms) {
+    if (!rb || !data || len == 0 || len > ring_usable(rb)) return false;
+    return ring_wait(rb, (void*)data, len, timeout_ms, ring_push_op,
+                     &rb->space_waiters, &rb->space_seq);
+}
+
+bool ring_pop_wait(RingBuffer* rb, void* data, size_t len, int timeout_ms) {
+    if (!rb || !data || len == 0 || len > ring_usable(rb)) return false;
+    return ring_wait(rb, data, len, timeout_ms, ring_pop_op,
+                     &rb->data_waiters, &rb->data_seq);
+}
+
+bool ring_reserve_write(RingBuffer* rb, size_t len, RingSpan* first, RingSpan* second) {
+    if (!rb || !first || !second) return false;
+
+    size_t head = atomic_load_explicit(&rb->head, memory_order_relaxed);
+    if (len == 0 || len > ring_writable(rb, head, len)) {
+        ring_spans(rb, 0, 0, first, second);
+        return false;
     }
 
-    atomic_store_explicit(&rb->tail, (tail + len) % rb->capacity, memory_order_release);
+    ring_spans(rb, ring_offset(rb, head), len, first, second);
     return true;
 }
 
+bool ring_commit_write(RingBuffer* rb, size_t len) {
+    if (!rb) return false;
+
+    size_t head = atomic_load_explicit(&rb->head, memory_order_relaxed);
+    if (len > ring_writable(rb, head, len)) return false;
+
+    ring_publish_head(rb, ring_advance(rb, head, len));
+    return true;
+}
+
+size_t ring_peek_read(RingBuffer* rb, RingSpan* first, RingSpan* second) {
+    if (!rb || !first || !second) return 0;
+
+    // Always refreshed: a stale view could hide the rest of a partial frame
+    size_t tail = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+    size_t available = ring_readable(rb, tail, SIZE_MAX);
+    ring_spans(rb, ring_offset(rb, tail), available, first, second);
+    return available;
+}
+
+bool ring_consume(RingBuffer* rb, size_t len) {
+    if (!rb) return false;
+
+    size_t tail = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+    if (len > ring_readable(rb, tail, len)) return false;
+
+    ring_publish_tail(rb, ring_advance(rb, tail, len));
+    return true;
+}
+
+typedef uint32_t RingRecordHeader;
+
+bool ring_push_record(RingBuffer* rb, const void* data, size_t len) {
+    if (!rb || (!data && len > 0) || len > UINT32_MAX) return false;
+
+    size_t total = sizeof(RingRecordHeader) + len;
+    size_t head = atomic_load_explicit(&rb->head, memory_order_relaxed);
+    if (total > ring_writable(rb, head, total)) return false;
+
+    RingRecordHeader header = (RingRecordHeader)len;
+    ring_copy_in(rb, ring_offset(rb, head), (const uint8_t*)&header, sizeof(header));
+    if (len > 0) {
+        size_t body = ring_advance(rb, head, sizeof(header));
+        ring_copy_in(rb, ring_offset(rb, body), (const uint8_t*)data, len);
+    }
+
+    ring_publish_head(rb, ring_advance(rb, head, total));
+    return true;
+}
+
+size_t ring_pop_batch(RingBuffer* rb, void* buf, size_t buf_len, size_t* lens, size_t max_records) {
+    if (!rb || !buf || !lens) return 0;
+
+    size_t tail = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+    size_t available = ring_readable(rb, tail, SIZE_MAX);
+
+    uint8_t* out = (uint8_t*)buf;
+    size_t used = 0;
+    size_t count = 0;
+    size_t pos = tail;
+    while (count < max_records && available >= sizeof(RingRecordHeader)) {
+        RingRecordHeader header;
+        ring_copy_out(rb, ring_offset(rb, pos), (uint8_t*)&header, sizeof(header));
+        size_t total = sizeof(header) + header;
+        if (total > available || header > buf_len - used) break;
+
+        ring_copy_out(rb, ring_offset(rb, ring_advance(rb, pos, sizeof(header))), out + used, header);
+        lens[count++] = header;
+        used += header;
+        available -= total;
+        pos = ring_advance(rb, pos, total);
+    }
+
+    if (count > 0) {
+        ring_publish_tail(rb, pos);
+    }
+    return count;
+}
+
 size_t ring_size(const RingBuffer* rb) {
     if (!rb) return 0;
-    size_t head = atomic_load_explicit(&rb->head, memory_order_acquire);
+    // Tail first: a head read afterwards can only be further ahead
     size_t tail = atomic_load_explicit(&rb->tail, memory_order_acquire);
-    return (head - tail + rb->capacity) % rb->capacity;
+    size_t head = atomic_load_explicit(&rb->head, memory_order_acquire);
+    size_t used = ring_used(rb, head, tail);
+    return used < ring_usable(rb) ? used : ring_usable(rb);
 }
 
 size_t ring_free_space(const RingBuffer* rb) {
     if (!rb) return 0;
-    return rb->capacity - 1 - ring_size(rb);
+    return ring_usable(rb) - ring_size(rb);
 }
 
 bool ring_is_empty(const RingBuffer* rb) {
@@ -83,3 +537,123 @@ bool ring_is_empty(const RingBuffer* rb) {
 bool ring_is_full(const RingBuffer* rb) {
     return ring_free_space(rb) == 0;
 }
+
+// Each cell is a sequence number followed by the payload. A cell at index i
+// is free for the producer at position pos when seq == pos, and holds data
+// for the consumer at pos when seq == pos + 1.
+typedef struct {
+    atomic_size_t seq;
+} MpmcCell;
+
+struct MpmcRing {
+    uint8_t* cells;
+    size_t stride;
+    size_t slot_size;
+    size_t mask;
+
+    _Alignas(RING_CACHE_LINE) atomic_size_t enqueue_pos;
+    _Alignas(RING_CACHE_LINE) atomic_size_t dequeue_pos;
+};
+
+static inline MpmcCell* ring_mpmc_cell(const MpmcRing* ring, size_t pos) {
+    return (MpmcCell*)(ring->cells + (pos & ring->mask) * ring->stride);
+}
+
+MpmcRing* ring_mpmc_create(size_t slot_size, size_t slot_count) {
+    if (slot_size == 0 || slot_count == 0 || slot_count > (SIZE_MAX >> 1) + 1) return NULL;
+
+    size_t count = 2;
+    while (count < slot_count) count <<= 1;
+
+    size_t align = _Alignof(max_align_t);
+    size_t stride = (sizeof(MpmcCell) + slot_size + align - 1) & ~(align - 1);
+    if (stride < slot_size || count > SIZE_MAX / stride) return NULL;
+
+    MpmcRing* ring = aligned_alloc(RING_CACHE_LINE, sizeof(MpmcRing));
+    if (!ring) return NULL;
+
+    size_t bytes = (count * stride + RING_CACHE_LINE - 1) & ~(size_t)(RING_CACHE_LINE - 1);
+    ring->cells = aligned_alloc(RING_CACHE_LINE, bytes);
+    if (!ring->cells) {
+        free(ring);
+        return NULL;
+    }
+
+    ring->stride = stride;
+    ring->slot_size = slot_size;
+    ring->mask = count - 1;
+    for (size_t i = 0; i < count; i++) {
+        atomic_init(&ring_mpmc_cell(ring, i)->seq, i);
+    }
+    atomic_init(&ring->enqueue_pos, 0);
+    atomic_init(&ring->dequeue_pos, 0);
+
+    return ring;
+}
+
+void ring_mpmc_destroy(MpmcRing* ring) {
+    if (ring) {
+        free(ring->cells);
+        free(ring);
+    }
+}
+
+bool ring_mpmc_push(MpmcRing* ring, const void* data) {
+    if (!ring || !data) return false;
+
+    MpmcCell* cell;
+    size_t pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+    for (;;) {
+        cell = ring_mpmc_cell(ring, pos);
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;   // The consumer a lap behind hasn't emptied it yet
+        } else {
+            pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    memcpy(cell + 1, data, ring->slot_size);
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+    return true;
+}
+
+bool ring_mpmc_pop(MpmcRing* ring, void* data) {
+    if (!ring || !data) return false;
+
+    MpmcCell* cell;
+    size_t pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+    for (;;) {
+        cell = ring_mpmc_cell(ring, pos);
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;   // Not yet written by its producer
+        } else {
+            pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+        }
+    }
+
+    memcpy(data, cell + 1, ring->slot_size);
+    atomic_store_explicit(&cell->seq, pos + ring->mask + 1, memory_order_release);
+    return true;
+}
+
+size_t ring_mpmc_size(const MpmcRing* ring) {
+    if (!ring) return 0;
+    size_t dequeue = atomic_load_explicit(&ring->dequeue_pos, memory_order_acquire);
+    size_t enqueue = atomic_load_explicit(&ring->enqueue_pos, memory_order_acquire);
+    size_t used = enqueue - dequeue;
+    return used <= ring->mask + 1 ? used : ring->mask + 1;
+}
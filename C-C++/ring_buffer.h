@@ -7,16 +7,92 @@
 #include <stdbool.h>
 #include <stdatomic.h>
 
+#define RING_CACHE_LINE 64
+#define RING_VERSION    1       // Bump whenever the RingBuffer layout changes
+
+typedef enum {
+    RING_FLAG_NONE = 0,
+    RING_FLAG_POW2 = 1 << 0   // Power-of-two capacity, masked free-running indices
+} RingFlags;
+
+// The producer and consumer each own a cache line holding their index and a
+// private copy of the other side's, which is only re-read when the ring
+// looks full (producer) or empty (consumer).
+//
+// The struct holds no pointers: the data lives data_offset bytes after the
+// struct itself, so a ring can sit in shared memory mapped at different
+// addresses in different processes.
 typedef struct {
-    uint8_t* buffer;
-    size_t capacity;
-    atomic_size_t head;  // Write position (producer)
-    atomic_size_t tail;  // Read position (consumer)
+    atomic_uint magic;       // Set last, once the ring is initialised
+    uint32_t version;        // RING_VERSION of the creator
+    uint32_t header_size;    // sizeof(RingBuffer) of the creator
+    bool mirrored;           // Data is mapped twice, back to back
+    bool mapped;             // Header and data are one mmap'd segment
+    bool shared;             // Segment may be mapped by other processes
+    size_t data_offset;      // Data starts this many bytes after the struct
+    size_t capacity;         // Bytes of data
+    size_t mask;             // capacity - 1 with RING_FLAG_POW2, otherwise 0
+
+    _Alignas(RING_CACHE_LINE) atomic_size_t head;  // Write position (producer)
+    size_t cached_tail;                            // Producer's last view of tail
+
+    _Alignas(RING_CACHE_LINE) atomic_size_t tail;  // Read position (consumer)
+    size_t cached_head;                            // Consumer's last view of head
+
+    // Futex words for ring_pop_wait/ring_push_wait, bumped on publish only
+    // while the matching waiter count is non-zero
+    _Alignas(RING_CACHE_LINE) atomic_uint data_waiters;
+    atomic_uint data_seq;
+    atomic_uint space_waiters;
+    atomic_uint space_seq;
 } RingBuffer;
 
+// Bounded multi-producer/multi-consumer queue of fixed-size slots
+typedef struct MpmcRing MpmcRing;
+
+// A contiguous region of ring memory
+typedef struct {
+    uint8_t* data;
+    size_t len;
+} RingSpan;
+
 // TODO: Document this function
 RingBuffer* ring_create(size_t capacity);
 
+// Creates a ring with the given flags. With RING_FLAG_POW2 capacity is
+// rounded up to a power of two and fully usable: head and tail run freely
+// and are masked on access, so no byte is sacrificed to tell full from
+// empty. Returns NULL on OOM or a zero POW2 capacity.
+RingBuffer* ring_create_ex(size_t capacity, unsigned flags);
+
+// Creates a power-of-two ring whose data (at least one page) is mapped
+// twice in a row, so byte i and byte i + capacity are the same memory.
+// Every push, pop, reservation or peek is then a single contiguous span.
+// Falls back to a plain RING_FLAG_POW2 ring (mirrored == false) if the
+// double mapping can't be set up.
+RingBuffer* ring_create_mirrored(size_t capacity);
+
+// Creates a mirrored (when possible) power-of-two ring in a new POSIX
+// shared-memory object, for one producer and one consumer process. Fails if
+// name already exists: a restarted process should ring_attach instead and
+// carries on from the indices stored in the segment, since a record only
+// becomes visible once it is fully written.
+RingBuffer* ring_create_shared(const char* name, size_t capacity);
+
+// Like ring_create_shared, but lays the ring out in an open file descriptor
+// (e.g. from memfd_create) that the caller can pass to another process.
+RingBuffer* ring_create_shared_fd(int fd, size_t capacity);
+
+// Maps an existing shared ring. Returns NULL unless the segment holds a fully
+// initialised ring of this RING_VERSION and layout.
+RingBuffer* ring_attach(const char* name);
+
+// Like ring_attach, for a descriptor passed from the creating process
+RingBuffer* ring_attach_fd(int fd);
+
+// Removes the shared-memory name; mapped rings stay usable until destroyed.
+bool ring_unlink(const char* name);
+
 // TODO: Document this function
 void ring_destroy(RingBuffer* rb);
 
@@ -26,6 +102,46 @@ bool ring_push(RingBuffer* rb, const void* data, size_t len);
 // TODO: Document this function
 bool ring_pop(RingBuffer* rb, void* data, size_t len);
 
+// Like ring_push, but waits up to timeout_ms (-1 = forever) for len bytes of
+// space. Spins briefly, then sleeps on a futex until the consumer frees
+// space. Returns false on timeout or if len can never fit.
+bool ring_push_wait(RingBuffer* rb, const void* data, size_t len, int timeout_ms);
+
+// Like ring_pop, but waits up to timeout_ms (-1 = forever) for len bytes.
+bool ring_pop_wait(RingBuffer* rb, void* data, size_t len, int timeout_ms);
+
+// Producer side of the zero-copy API. Reserves len bytes of free space and
+// describes it as up to two regions (second->len is 0 unless the space
+// wraps). Returns false, leaving the spans empty, if len bytes aren't free.
+// Nothing becomes visible to the consumer until ring_commit_write.
+bool ring_reserve_write(RingBuffer* rb, size_t len, RingSpan* first, RingSpan* second);
+
+// Publishes the first len bytes of the last reservation. Returns false if
+// len exceeds the free space.
+bool ring_commit_write(RingBuffer* rb, size_t len);
+
+// Consumer side of the zero-copy API. Describes all readable bytes as up to
+// two regions and returns their total length. The data stays in the ring
+// until ring_consume.
+size_t ring_peek_read(RingBuffer* rb, RingSpan* first, RingSpan* second);
+
+// Releases len bytes from the read side. Returns false if fewer are readable.
+bool ring_consume(RingBuffer* rb, size_t len);
+
+// Record mode: each message is stored as a uint32_t length followed by the
+// payload. Don't mix record calls with plain ring_push/ring_pop on one ring.
+//
+// Writes the header and len payload bytes and publishes both with a single
+// head store. Returns false if the whole record doesn't fit.
+bool ring_push_record(RingBuffer* rb, const void* data, size_t len);
+
+// Drains up to max_records whole records, packing their payloads back to
+// back into buf (at most buf_len bytes) and their lengths into lens. tail is
+// published once for the whole batch. Returns the number of records taken;
+// stops early at a record that wouldn't fit, so buf must hold the largest
+// record the producer can send.
+size_t ring_pop_batch(RingBuffer* rb, void* buf, size_t buf_len, size_t* lens, size_t max_records);
+
 // TODO: Document this function
 size_t ring_size(const RingBuffer* rb);
 
@@ -38,4 +154,24 @@ bool ring_is_empty(const RingBuffer* rb);
 // TODO: Document this function
 bool ring_is_full(const RingBuffer* rb);
 
+// Creates an MPMC ring of slot_count (rounded up to a power of two) slots of
+// slot_size bytes each. Any number of threads may push and pop concurrently:
+// each slot carries a sequence number that says whose turn it is, so
+// producers and consumers only contend on their own position counter.
+MpmcRing* ring_mpmc_create(size_t slot_size, size_t slot_count);
+
+// Frees the ring. No thread may still be using it.
+void ring_mpmc_destroy(MpmcRing* ring);
+
+// Copies slot_size bytes from data into the next free slot. Returns false
+// without blocking if the ring is full.
+bool ring_mpmc_push(MpmcRing* ring, const void* data);
+
+// Copies the oldest slot into data (slot_size bytes). Returns false without
+// blocking if the ring is empty.
+bool ring_mpmc_pop(MpmcRing* ring, void* data);
+
+// Returns the number of filled slots; approximate while threads are active.
+size_t ring_mpmc_size(const MpmcRing* ring);
+
 #endif
@@ -0,0 +1,182 @@
+// ring_mpmc_stress.c
+//
+// Stress test and throughput benchmark for MpmcRing. Producers push tagged
+// items through a small ring while consumers pop them; afterwards every item
+// must have been seen exactly once. The same item count is then timed
+// through the SPSC RingBuffer with one producer and one consumer;
+// event_queue_throughput.cpp runs the same workload through EventQueue.
+//
+//   cc -std=gnu11 -O2 -pthread ring_mpmc_stress.c ring_buffer.c -o ring_mpmc_stress
+//   ./ring_mpmc_stress [producers] [consumers] [items_per_producer] [slots]
+//
+// Exits with status 1 if an item was lost or duplicated.
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "ring_buffer.h"
+
+typedef struct {
+    uint32_t producer;
+    uint32_t seq;
+    uint64_t payload;     // Bytes that must arrive intact along with the tag
+} Item;
+
+typedef struct {
+    MpmcRing* ring;
+    RingBuffer* spsc;
+    uint32_t producers;
+    uint32_t per_producer;
+    atomic_uint producers_left;
+    atomic_uint* seen;    // Times each (producer, seq) was popped
+    atomic_ulong corrupt;
+} Shared;
+
+typedef struct {
+    Shared* shared;
+    uint32_t id;
+} Worker;
+
+static uint64_t payload_of(uint32_t producer, uint32_t seq) {
+    return ((uint64_t)producer << 32 | seq) * 0x9e3779b97f4a7c15ULL;
+}
+
+static double seconds_since(const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void* mpmc_producer(void* arg) {
+    Worker* w = arg;
+    Shared* s = w->shared;
+    for (uint32_t i = 0; i < s->per_producer; i++) {
+        Item item = { w->id, i, payload_of(w->id, i) };
+        while (!ring_mpmc_push(s->ring, &item)) sched_yield();
+    }
+    atomic_fetch_sub(&s->producers_left, 1);
+    return NULL;
+}
+
+static void record(Shared* s, const Item* item) {
+    if (item->producer >= s->producers || item->seq >= s->per_producer ||
+        item->payload != payload_of(item->producer, item->seq)) {
+        atomic_fetch_add(&s->corrupt, 1);
+        return;
+    }
+    atomic_fetch_add_explicit(&s->seen[(size_t)item->producer * s->per_producer + item->seq], 1,
+                              memory_order_relaxed);
+}
+
+static void* mpmc_consumer(void* arg) {
+    Worker* w = arg;
+    Shared* s = w->shared;
+    Item item;
+    for (;;) {
+        if (ring_mpmc_pop(s->ring, &item)) {
+            record(s, &item);
+        } else if (atomic_load(&s->producers_left) == 0) {
+            // Producers are done: whatever is left can be drained without waiting
+            if (!ring_mpmc_pop(s->ring, &item)) return NULL;
+            record(s, &item);
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+static void* spsc_producer(void* arg) {
+    Shared* s = arg;
+    uint64_t total = (uint64_t)s->producers * s->per_producer;
+    for (uint64_t i = 0; i < total; i++) {
+        Item item = { 0, (uint32_t)i, payload_of(0, (uint32_t)i) };
+        while (!ring_push(s->spsc, &item, sizeof(item))) sched_yield();
+    }
+    return NULL;
+}
+
+static bool run_mpmc(Shared* s, uint32_t consumers) {
+    uint32_t producers = s->producers;
+    pthread_t threads[producers + consumers];
+    Worker workers[producers + consumers];
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t i = 0; i < producers + consumers; i++) {
+        workers[i] = (Worker){ s, i < producers ? i : i - producers };
+        pthread_create(&threads[i], NULL, i < producers ? mpmc_producer : mpmc_consumer, &workers[i]);
+    }
+    for (uint32_t i = 0; i < producers + consumers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double elapsed = seconds_since(&start);
+
+    size_t total = (size_t)producers * s->per_producer;
+    size_t lost = 0, duplicated = 0;
+    for (size_t i = 0; i < total; i++) {
+        unsigned n = atomic_load(&s->seen[i]);
+        if (n == 0) lost++;
+        if (n > 1) duplicated++;
+    }
+    unsigned long corrupt = atomic_load(&s->corrupt);
+
+    printf("mpmc %ux%u: %zu items in %.3f s (%.1f M items/s), lost %zu, duplicated %zu, corrupt %lu, left %zu\n",
+           producers, consumers, total, elapsed, (double)total / elapsed / 1e6, lost, duplicated, corrupt,
+           ring_mpmc_size(s->ring));
+    return lost == 0 && duplicated == 0 && corrupt == 0 && ring_mpmc_size(s->ring) == 0;
+}
+
+static bool run_spsc(Shared* s) {
+    uint64_t total = (uint64_t)s->producers * s->per_producer;
+    uint64_t bad = 0;
+    pthread_t producer;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_create(&producer, NULL, spsc_producer, s);
+    for (uint64_t i = 0; i < total; i++) {
+        Item item;
+        while (!ring_pop(s->spsc, &item, sizeof(item))) sched_yield();
+        if (item.seq != (uint32_t)i || item.payload != payload_of(0, (uint32_t)i)) bad++;
+    }
+    pthread_join(producer, NULL);
+    double elapsed = seconds_since(&start);
+
+    printf("spsc 1x1: %llu items in %.3f s (%.1f M items/s), out of order or corrupt %llu\n",
+           (unsigned long long)total, elapsed, (double)total / elapsed / 1e6, (unsigned long long)bad);
+    return bad == 0;
+}
+
+int main(int argc, char** argv) {
+    uint32_t producers = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 4;
+    uint32_t consumers = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 4;
+    uint32_t per_producer = argc > 3 ? (uint32_t)strtoul(argv[3], NULL, 10) : 1000000;
+    size_t slots = argc > 4 ? strtoul(argv[4], NULL, 10) : 1024;
+    if (producers == 0 || consumers == 0 || per_producer == 0 || slots == 0) {
+        fprintf(stderr, "usage: %s [producers] [consumers] [items_per_producer] [slots]\n", argv[0]);
+        return 2;
+    }
+
+    Shared s = { .producers = producers, .per_producer = per_producer };
+    atomic_init(&s.producers_left, producers);
+    atomic_init(&s.corrupt, 0);
+    s.seen = calloc((size_t)producers * per_producer, sizeof(*s.seen));
+    s.ring = ring_mpmc_create(sizeof(Item), slots);
+    s.spsc = ring_create(slots * sizeof(Item));
+    if (!s.seen || !s.ring || !s.spsc) {
+        fprintf(stderr, "allocation failed\n");
+        return 2;
+    }
+
+    bool ok = run_mpmc(&s, consumers);
+    ok = run_spsc(&s) && ok;
+
+    ring_destroy(s.spsc);
+    ring_mpmc_destroy(s.ring);
+    free(s.seen);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+// small_alloc.c
+#define _DEFAULT_SOURCE // MAP_ANONYMOUS, MAP_NORESERVE
+#include "small_alloc.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define SMALL_DEFAULT_ARENA ((size_t)64 << 20)
+
+typedef struct {
+    MemoryPool* pool;
+    size_t block_size;
+    size_t capacity;
+    size_t requested_bytes;         // Single-threaded allocators only
+} SmallClass;
+
+// Every class owns one equally sized, power-of-two slice of a single address
+// range reservation, so the class of any block is (ptr - base) >> arena_shift.
+struct SmallAlloc {
+    uint8_t* base;
+    size_t arena_shift;
+    size_t reserved;
+    bool concurrent;
+    SmallClass classes[SMALL_ALLOC_CLASSES];
+};
+
+static size_t small_class_index(size_t size) {
+    return size == 0 ? 0 : (size - 1) / SMALL_ALLOC_GRANULE;
+}
+
+static bool small_owns(const SmallAlloc* alloc, const void* ptr) {
+    uintptr_t p = (uintptr_t)ptr;
+    uintptr_t base = (uintptr_t)alloc->base;
+    return p >= base && p - base < alloc->reserved;
+}
+
+SmallAlloc* small_alloc_create(size_t arena_size, unsigned pool_flags) {
+    if (arena_size == 0) arena_size = SMALL_DEFAULT_ARENA;
+    if (pool_flags & (POOL_FLAG_GROWABLE | POOL_FLAG_MMAP | POOL_FLAG_HUGE_PAGES)) {
+        return NULL; // Class pools live in the allocator's own reservation
+    }
+
+    size_t shift = 12;
+    while (((size_t)1 << shift) < arena_size) shift++;
+    arena_size = (size_t)1 << shift;
+
+    SmallAlloc* alloc = malloc(sizeof(SmallAlloc));
+    if (!alloc) return NULL;
+    memset(alloc, 0, sizeof(SmallAlloc));
+
+    alloc->arena_shift = shift;
+    alloc->reserved = arena_size * SMALL_ALLOC_CLASSES;
+    alloc->concurrent = (pool_flags & POOL_FLAG_CONCURRENT) != 0;
+    alloc->base = mmap(NULL, alloc->reserved, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (alloc->base == MAP_FAILED) {
+        free(alloc);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < SMALL_ALLOC_CLASSES; i++) {
+        SmallClass* cls = &alloc->classes[i];
+        cls->block_size = (i + 1) * SMALL_ALLOC_GRANULE;
+        cls->capacity = arena_size / cls->block_size;
+
+        PoolOptions opts = {
+            .block_size = cls->block_size,
+            .block_count = cls->capacity,
+            .flags = pool_flags,
+            .memory = alloc->base + (i << shift),
+        };
+        cls->pool = pool_create_ex(&opts);
+        if (!cls->pool) {
+            small_alloc_destroy(alloc);
+            return NULL;
+        }
+    }
+
+    return alloc;
+}
+
+void small_alloc_destroy(SmallAlloc* alloc) {
+    if (alloc) {
+        for (size_t i = 0; i < SMALL_ALLOC_CLASSES; i++) {
+            pool_destroy(alloc->classes[i].pool);
+        }
+        munmap(alloc->base, alloc->reserved);
+        free(alloc);
+    }
+}
+
+void* small_malloc(SmallAlloc* alloc, size_t size) {
+    if (!alloc) return NULL;
+    if (size > SMALL_ALLOC_MAX_SIZE) return malloc(size);
+
+    SmallClass* cls = &alloc->classes[small_class_index(size)];
+    void* block = pool_alloc(cls->pool);
+    if (block && !alloc->concurrent) {
+        cls->requested_bytes += size;
+    }
+    return block;
+}
+
+void small_free(SmallAlloc* alloc, void* ptr) {
+    if (!alloc || !ptr) return;
+    if (!small_owns(alloc, ptr)) {
+        free(ptr);
+        return;
+    }
+
+    size_t index = ((uintptr_t)ptr - (uintptr_t)alloc->base) >> alloc->arena_shift;
+    pool_free(alloc->classes[index].pool, ptr);
+}
+
+size_t small_usable_size(const SmallAlloc* alloc, const void* ptr) {
+    if (!alloc || !ptr || !small_owns(alloc, ptr)) return 0;
+    size_t index = ((uintptr_t)ptr - (uintptr_t)alloc->base) >> alloc->arena_shift;
+    return alloc->classes[index].block_size;
+}
+
+bool small_class_stats(const SmallAlloc* alloc, size_t class_index, SmallClassStats* out) {
+    if (!alloc || !out || class_index >= SMALL_ALLOC_CLASSES) return false;
+
+    const SmallClass* cls = &alloc->classes[class_index];
+    PoolStats pool;
+    pool_stats(cls->pool, &pool);
+
+    memset(out, 0, sizeof(*out));
+    out->block_size = cls->block_size;
+    out->capacity = cls->capacity;
+    out->in_use = pool.in_use;
+    out->peak_in_use = pool.peak_in_use;
+    out->total_allocs = pool.total_allocs;
+    if (pool.peak_in_use > 0) {
+        out->external_fragmentation = 1.0 - (double)pool.in_use / (double)pool.peak_in_use;
+    }
+
+    if (!alloc->concurrent && pool.total_allocs > 0) {
+        double allocated = (double)pool.total_allocs * (double)cls->block_size;
+        out->requested_bytes = cls->requested_bytes;
+        out->internal_fragmentation = 1.0 - (double)cls->requested_bytes / allocated;
+    }
+    return true;
+}
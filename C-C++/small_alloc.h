@@ -0,0 +1,64 @@
+// small_alloc.h
+// A size-class allocator for small objects, built on MemoryPool
+
+#ifndef SMALL_ALLOC_H
+#define SMALL_ALLOC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "memory_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SMALL_ALLOC_GRANULE   16
+#define SMALL_ALLOC_MAX_SIZE  512
+#define SMALL_ALLOC_CLASSES   (SMALL_ALLOC_MAX_SIZE / SMALL_ALLOC_GRANULE)
+
+typedef struct SmallAlloc SmallAlloc;
+
+typedef struct {
+    size_t block_size;
+    size_t capacity;                // Blocks reserved for this class
+    size_t in_use;
+    size_t peak_in_use;             // High-water mark of in_use
+    size_t total_allocs;
+    size_t requested_bytes;         // Sum of sizes passed to small_malloc
+    double internal_fragmentation;  // Share of allocated bytes lost to rounding
+    double external_fragmentation;  // Share of the high-water mark now idle
+} SmallClassStats;
+
+// Creates an allocator with one pool per 16-byte size class up to 512 bytes.
+// arena_size is the virtual address space reserved per class (rounded up to
+// a power of two; 0 picks 64 MiB). Only pages that are actually used get
+// backed by memory. pool_flags is passed to every class pool (e.g.
+// POOL_FLAG_CONCURRENT for multi-threaded use).
+SmallAlloc* small_alloc_create(size_t arena_size, unsigned pool_flags);
+
+// Releases the allocator and every block it handed out.
+void small_alloc_destroy(SmallAlloc* alloc);
+
+// Returns a block of at least size bytes, 16-byte aligned. Sizes above
+// SMALL_ALLOC_MAX_SIZE are passed through to malloc. Returns NULL when the
+// class is exhausted.
+void* small_malloc(SmallAlloc* alloc, size_t size);
+
+// Frees a block from small_malloc. The size class is found from the address.
+void small_free(SmallAlloc* alloc, void* ptr);
+
+// Returns the usable size of a block from small_malloc, or 0 for pointers the
+// allocator passed through to malloc.
+size_t small_usable_size(const SmallAlloc* alloc, const void* ptr);
+
+// Fills out with usage and fragmentation figures for one size class.
+// Returns false if class_index is out of range. POOL_FLAG_CONCURRENT
+// allocators don't track requested_bytes or internal_fragmentation.
+bool small_class_stats(const SmallAlloc* alloc, size_t class_index, SmallClassStats* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SMALL_ALLOC_H
@@ -0,0 +1,493 @@
+// timer_event_queue.hpp
+#ifndef TIMER_EVENT_QUEUE_HPP
+#define TIMER_EVENT_QUEUE_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+// A blocking queue whose items carry a priority and an optional not-before
+// time. Items that are due come out highest priority first, FIFO within a
+// priority; items that aren't due yet wait in a hierarchical timing wheel
+// (six levels of 64 slots) where insert and cancel are O(1). Consumers
+// sleep until the next tick at which the wheel has work, so one thread can
+// service any number of pending timers.
+//
+// close() has EventQueue semantics: pushes fail and pops keep returning
+// items that are already due, then std::nullopt. Timers not yet due at that
+// point are never delivered.
+template<typename T>
+class TimerEventQueue {
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimerId = uint64_t;     // 0 is never a valid id
+
+    // tick is the wheel resolution; deadlines are rounded up to it.
+    explicit TimerEventQueue(Clock::duration tick = std::chrono::milliseconds(1));
+
+    ~TimerEventQueue();
+
+    // Queues an item that is due immediately. Returns false if closed.
+    bool push(const T& item, int priority = 0);
+    bool push(T&& item, int priority = 0);
+
+    // Queues item to become due at not_before. Returns an id for cancel(),
+    // or 0 if the queue is closed.
+    TimerId push_at(T item, Clock::time_point not_before, int priority = 0);
+
+    // Queues item to become due after delay.
+    template<typename Rep, typename Period>
+    TimerId push_after(T item, const std::chrono::duration<Rep, Period>& delay, int priority = 0);
+
+    // Removes a queued item. Returns false if it was already popped,
+    // cancelled or cleared.
+    bool cancel(TimerId id);
+
+    // Waits for the next due item; std::nullopt once closed and drained.
+    std::optional<T> pop();
+
+    // Returns a due item, if any, without waiting.
+    std::optional<T> try_pop();
+
+    template<typename Rep, typename Period>
+    std::optional<T> pop_for(const std::chrono::duration<Rep, Period>& timeout);
+
+    template<typename Clock2, typename Duration>
+    std::optional<T> pop_until(const std::chrono::time_point<Clock2, Duration>& deadline);
+
+    void close();
+    bool is_closed() const;
+
+    // Number of queued items, due or not.
+    size_t size() const;
+    bool empty() const;
+
+    // Drops every queued item and invalidates their ids.
+    void clear();
+
+    // Non-copyable, non-movable
+    TimerEventQueue(const TimerEventQueue&) = delete;
+    TimerEventQueue& operator=(const TimerEventQueue&) = delete;
+    TimerEventQueue(TimerEventQueue&&) = delete;
+    TimerEventQueue& operator=(TimerEventQueue&&) = delete;
+
+private:
+    static constexpr unsigned wheel_bits = 6;
+    static constexpr unsigned wheel_slots = 1u << wheel_bits;
+    static constexpr unsigned wheel_levels = 6;
+    static constexpr uint64_t wheel_range = uint64_t(1) << (wheel_bits * wheel_levels);
+    static constexpr uint32_t npos = UINT32_MAX;
+
+    // Timers beyond the wheel's current range wait here and are filed again
+    // each time the top level wraps around. It counts as one extra level
+    // with a single slot.
+    static constexpr uint32_t overflow_list = wheel_levels * wheel_slots;
+
+    enum class NodeState : uint8_t { Free, Waiting, Ready };
+
+    // Timer nodes live in a vector and link to each other by index; a
+    // TimerId is the node index plus a generation that changes on reuse.
+    struct Node {
+        std::optional<T> item;
+        uint64_t expiry = 0;          // Tick at which the item is due
+        int priority = 0;
+        uint32_t prev = npos;
+        uint32_t next = npos;
+        uint32_t list = npos;         // Wheel slot (level * wheel_slots + slot) or overflow_list
+        uint32_t generation = 0;
+        NodeState state = NodeState::Free;
+    };
+
+    struct ReadyEntry {
+        int priority;
+        uint64_t seq;
+        uint32_t index;
+        uint32_t generation;
+    };
+
+    struct ReadyOrder {
+        bool operator()(const ReadyEntry& a, const ReadyEntry& b) const {
+            return a.priority != b.priority ? a.priority < b.priority : a.seq > b.seq;
+        }
+    };
+
+    uint64_t tick_ceil(Clock::time_point tp) const;
+    uint64_t tick_floor(Clock::time_point tp) const;
+    Clock::time_point time_of(uint64_t tick) const;
+
+    uint32_t allocate_node(T&& item, uint64_t expiry, int priority);
+    void free_node(uint32_t index);
+    TimerId enqueue(T&& item, uint64_t expiry, int priority);
+
+    void file(uint32_t index);
+    void link(uint32_t list, uint32_t index);
+    void unlink(uint32_t index);
+    void make_ready(uint32_t index);
+    bool next_event(uint64_t& tick) const;
+    void advance(uint64_t target);
+    std::optional<T> take_ready();
+    std::optional<T> pop_wait(const Clock::time_point* deadline);
+
+    mutable std::mutex mutex_;
+    std::condition_variable not_empty_;
+    Clock::time_point epoch_;
+    Clock::duration tick_;
+    uint64_t current_tick_ = 0;       // Every tick up to here has been processed
+    uint64_t ready_seq_ = 0;
+    std::vector<Node> nodes_;
+    std::vector<uint32_t> free_nodes_;
+    uint32_t heads_[wheel_levels * wheel_slots + 1];
+    uint64_t occupied_[wheel_levels + 1] = {};  // Non-empty slots per level
+    std::vector<ReadyEntry> ready_;             // Heap ordered by ReadyOrder
+    size_t size_ = 0;
+    size_t waiting_consumers_ = 0;
+    bool closed_ = false;
+};
+
+// Implementation
+template<typename T>
+TimerEventQueue<T>::TimerEventQueue(Clock::duration tick) : epoch_(Clock::now()), tick_(tick) {
+    if (tick <= Clock::duration::zero()) {
+        throw std::invalid_argument("TimerEventQueue tick must be > 0");
+    }
+    std::fill(std::begin(heads_), std::end(heads_), npos);
+}
+
+template<typename T>
+TimerEventQueue<T>::~TimerEventQueue() {
+    close();
+}
+
+template<typename T>
+uint64_t TimerEventQueue<T>::tick_ceil(Clock::time_point tp) const {
+    if (tp <= epoch_) return 0;
+    return static_cast<uint64_t>((tp - epoch_ + tick_ - Clock::duration(1)) / tick_);
+}
+
+template<typename T>
+uint64_t TimerEventQueue<T>::tick_floor(Clock::time_point tp) const {
+    if (tp <= epoch_) return 0;
+    return static_cast<uint64_t>((tp - epoch_) / tick_);
+}
+
+template<typename T>
+typename TimerEventQueue<T>::Clock::time_point TimerEventQueue<T>::time_of(uint64_t tick) const {
+    return epoch_ + tick_ * static_cast<Clock::rep>(tick);
+}
+
+template<typename T>
+uint32_t TimerEventQueue<T>::allocate_node(T&& item, uint64_t expiry, int priority) {
+    uint32_t index;
+    if (!free_nodes_.empty()) {
+        index = free_nodes_.back();
+        free_nodes_.pop_back();
+    } else {
+        if (nodes_.size() >= npos) throw std::length_error("TimerEventQueue is full");
+        index = static_cast<uint32_t>(nodes_.size());
+        nodes_.emplace_back();
+    }
+
+    Node& node = nodes_[index];
+    node.item.emplace(std::move(item));
+    node.expiry = expiry;
+    node.priority = priority;
+    node.state = NodeState::Waiting;
+    size_++;
+    return index;
+}
+
+template<typename T>
+void TimerEventQueue<T>::free_node(uint32_t index) {
+    Node& node = nodes_[index];
+    node.item.reset();
+    node.state = NodeState::Free;
+    node.generation++;
+    free_nodes_.push_back(index);
+    size_--;
+}
+
+template<typename T>
+typename TimerEventQueue<T>::TimerId TimerEventQueue<T>::enqueue(T&& item, uint64_t expiry, int priority) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closed_) return 0;
+
+    uint32_t index = allocate_node(std::move(item), expiry, priority);
+    file(index);
+    if (waiting_consumers_ > 0) not_empty_.notify_one();
+    return (static_cast<TimerId>(nodes_[index].generation) << 32) | (index + 1);
+}
+
+template<typename T>
+bool TimerEventQueue<T>::push(const T& item, int priority) {
+    T copy(item);
+    return enqueue(std::move(copy), 0, priority) != 0;
+}
+
+template<typename T>
+bool TimerEventQueue<T>::push(T&& item, int priority) {
+    return enqueue(std::move(item), 0, priority) != 0;
+}
+
+template<typename T>
+typename TimerEventQueue<T>::TimerId TimerEventQueue<T>::push_at(T item, Clock::time_point not_before, int priority) {
+    return enqueue(std::move(item), tick_ceil(not_before), priority);
+}
+
+template<typename T>
+template<typename Rep, typename Period>
+typename TimerEventQueue<T>::TimerId TimerEventQueue<T>::push_after(T item, const std::chrono::duration<Rep, Period>& delay,
+                                                                    int priority) {
+    auto not_before = Clock::now() + std::chrono::ceil<Clock::duration>(delay);
+    return push_at(std::move(item), not_before, priority);
+}
+
+template<typename T>
+bool TimerEventQueue<T>::cancel(TimerId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t slot = id & 0xffffffffu;
+    if (slot == 0 || slot > nodes_.size()) return false;
+
+    uint32_t index = static_cast<uint32_t>(slot - 1);
+    Node& node = nodes_[index];
+    if (node.state == NodeState::Free || node.generation != static_cast<uint32_t>(id >> 32)) return false;
+
+    // A ready node's heap entry goes stale and is skipped by take_ready
+    if (node.state == NodeState::Waiting) unlink(index);
+    free_node(index);
+    return true;
+}
+
+// Puts a waiting node in the wheel slot for its expiry, or on the ready heap
+// if it is already due. The level is the highest 6-bit digit in which the
+// expiry differs from the current tick; expiries that differ above the top
+// level go to the overflow list.
+template<typename T>
+void TimerEventQueue<T>::file(uint32_t index) {
+    Node& node = nodes_[index];
+    if (node.expiry <= current_tick_) {
+        make_ready(index);
+        return;
+    }
+
+    unsigned level = (63 - __builtin_clzll(node.expiry ^ current_tick_)) / wheel_bits;
+    if (level >= wheel_levels) {
+        link(overflow_list, index);
+        return;
+    }
+    unsigned slot = (node.expiry >> (level * wheel_bits)) & (wheel_slots - 1);
+    link(level * wheel_slots + slot, index);
+}
+
+template<typename T>
+void TimerEventQueue<T>::link(uint32_t list, uint32_t index) {
+    Node& node = nodes_[index];
+    node.list = list;
+    node.prev = npos;
+    node.next = heads_[list];
+    if (node.next != npos) nodes_[node.next].prev = index;
+    heads_[list] = index;
+    occupied_[list / wheel_slots] |= uint64_t(1) << (list % wheel_slots);
+}
+
+template<typename T>
+void TimerEventQueue<T>::unlink(uint32_t index) {
+    Node& node = nodes_[index];
+    if (node.prev != npos) {
+        nodes_[node.prev].next = node.next;
+    } else {
+        heads_[node.list] = node.next;
+        if (node.next == npos) {
+            occupied_[node.list / wheel_slots] &= ~(uint64_t(1) << (node.list % wheel_slots));
+        }
+    }
+    if (node.next != npos) nodes_[node.next].prev = node.prev;
+    node.prev = node.next = node.list = npos;
+}
+
+template<typename T>
+void TimerEventQueue<T>::make_ready(uint32_t index) {
+    Node& node = nodes_[index];
+    node.state = NodeState::Ready;
+    ready_.push_back({node.priority, ready_seq_++, index, node.generation});
+    std::push_heap(ready_.begin(), ready_.end(), ReadyOrder());
+}
+
+// Finds the earliest tick after current_tick_ at which an occupied slot is
+// reached: due items on level 0, items to re-file on the levels above and,
+// at the next wrap of the top level, the overflow list.
+template<typename T>
+bool TimerEventQueue<T>::next_event(uint64_t& tick) const {
+    bool found = false;
+    if (occupied_[wheel_levels]) {
+        tick = (current_tick_ | (wheel_range - 1)) + 1;
+        found = true;
+    }
+    for (unsigned level = 0; level < wheel_levels; level++) {
+        unsigned shift = level * wheel_bits;
+        unsigned digit = (current_tick_ >> shift) & (wheel_slots - 1);
+        uint64_t later = digit + 1 < wheel_slots ? occupied_[level] & (~uint64_t(0) << (digit + 1)) : 0;
+        if (!later) continue;
+
+        uint64_t base = current_tick_ & ~((uint64_t(1) << (shift + wheel_bits)) - 1);
+        uint64_t candidate = base | (static_cast<uint64_t>(__builtin_ctzll(later)) << shift);
+        if (!found || candidate < tick) tick = candidate;
+        found = true;
+    }
+    return found;
+}
+
+// Moves the wheel forward to target, jumping straight between occupied slots
+template<typename T>
+void TimerEventQueue<T>::advance(uint64_t target) {
+    uint64_t next;
+    while (next_event(next) && next <= target) {
+        current_tick_ = next;
+
+        for (unsigned level = wheel_levels; level > 0; level--) {
+            unsigned shift = level * wheel_bits;
+            if (current_tick_ & ((uint64_t(1) << shift) - 1)) continue;
+
+            uint32_t list = level == wheel_levels ? overflow_list
+                                                  : level * wheel_slots + ((current_tick_ >> shift) & (wheel_slots - 1));
+
+            // Detach the whole list first: overflow timers still out of
+            // range are filed straight back onto it.
+            uint32_t index = heads_[list];
+            heads_[list] = npos;
+            occupied_[list / wheel_slots] &= ~(uint64_t(1) << (list % wheel_slots));
+            while (index != npos) {
+                uint32_t next_index = nodes_[index].next;
+                nodes_[index].prev = nodes_[index].next = nodes_[index].list = npos;
+                file(index);
+                index = next_index;
+            }
+        }
+
+        uint32_t list = current_tick_ & (wheel_slots - 1);
+        while (heads_[list] != npos) {
+            uint32_t index = heads_[list];
+            unlink(index);
+            make_ready(index);
+        }
+    }
+    current_tick_ = std::max(current_tick_, target);
+}
+
+template<typename T>
+std::optional<T> TimerEventQueue<T>::take_ready() {
+    while (!ready_.empty()) {
+        std::pop_heap(ready_.begin(), ready_.end(), ReadyOrder());
+        ReadyEntry entry = ready_.back();
+        ready_.pop_back();
+
+        Node& node = nodes_[entry.index];
+        if (node.state != NodeState::Ready || node.generation != entry.generation) continue;
+
+        std::optional<T> item(std::move(node.item));
+        free_node(entry.index);
+        return item;
+    }
+    return std::nullopt;
+}
+
+template<typename T>
+std::optional<T> TimerEventQueue<T>::pop_wait(const Clock::time_point* deadline) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    for (;;) {
+        Clock::time_point now = Clock::now();
+        if (!closed_) advance(tick_floor(now));
+        if (auto item = take_ready()) {
+            if (!ready_.empty() && waiting_consumers_ > 0) not_empty_.notify_one();
+            return item;
+        }
+        if (closed_ || (deadline && now >= *deadline)) return std::nullopt;
+
+        uint64_t next;
+        bool timed = next_event(next);
+        Clock::time_point wake = timed ? time_of(next) : Clock::time_point::max();
+        if (deadline && *deadline < wake) wake = *deadline;
+
+        waiting_consumers_++;
+        if (wake == Clock::time_point::max()) {
+            not_empty_.wait(lock);
+        } else {
+            not_empty_.wait_until(lock, wake);
+        }
+        waiting_consumers_--;
+    }
+}
+
+template<typename T>
+std::optional<T> TimerEventQueue<T>::pop() {
+    return pop_wait(nullptr);
+}
+
+template<typename T>
+std::optional<T> TimerEventQueue<T>::try_pop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!closed_) advance(tick_floor(Clock::now()));
+    return take_ready();
+}
+
+template<typename T>
+template<typename Rep, typename Period>
+std::optional<T> TimerEventQueue<T>::pop_for(const std::chrono::duration<Rep, Period>& timeout) {
+    Clock::time_point deadline = Clock::now() + std::chrono::ceil<Clock::duration>(timeout);
+    return pop_wait(&deadline);
+}
+
+template<typename T>
+template<typename Clock2, typename Duration>
+std::optional<T> TimerEventQueue<T>::pop_until(const std::chrono::time_point<Clock2, Duration>& deadline) {
+    auto remaining = deadline - Clock2::now();
+    Clock::time_point steady_deadline = Clock::now() + std::chrono::ceil<Clock::duration>(remaining);
+    return pop_wait(&steady_deadline);
+}
+
+// The wheel stops at the close: what is due by now stays poppable, later
+// timers never become due.
+template<typename T>
+void TimerEventQueue<T>::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!closed_) advance(tick_floor(Clock::now()));
+        closed_ = true;
+    }
+    not_empty_.notify_all();
+}
+
+template<typename T>
+bool TimerEventQueue<T>::is_closed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return closed_;
+}
+
+template<typename T>
+size_t TimerEventQueue<T>::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+}
+
+template<typename T>
+bool TimerEventQueue<T>::empty() const {
+    return size() == 0;
+}
+
+template<typename T>
+void TimerEventQueue<T>::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (uint32_t index = 0; index < nodes_.size(); index++) {
+        if (nodes_[index].state == NodeState::Free) continue;
+        if (nodes_[index].state == NodeState::Waiting) unlink(index);
+        free_node(index);
+    }
+    ready_.clear();
+}
+
+#endif // TIMER_EVENT_QUEUE_HPP